@@ -0,0 +1,79 @@
+#!/bin/bash
+#
+# usage: ./bench.sh <top dir> [seconds] [nodes]
+#
+# Run hohha_brut on the checked-in corpora, and on corpora generated with
+# fixed seeds, each capped by time and maybe by nodes, and stopped at the
+# first solution.  Print one line per run, with the stats of hohha_brut:
+# nodes, seconds, nodes/s, time to the first solution, and peak RSS.  A
+# solution is "solved" if its key body equals the secret key.
+#
+
+TOP=${1:-..}
+SECS=${2:-30}
+NODES=${3:-}
+
+BRUT="$TOP/hohha_brut"
+GENKPA="$TOP/hohha_genkpa"
+
+# the seed of hohha_brut -s, for every run
+SEED=1
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+CAPS=(-T "$SECS")
+if [ -n "$NODES" ]; then
+	CAPS+=(-N "$NODES")
+fi
+
+# run <name> <jumps> <length> <key file> <msg file>
+run() {
+	local name=$1 jumps=$2 len=$3 key=$4 msg=$5
+	local out="$TMP/out.txt" err="$TMP/err.txt" stats result
+
+	"$BRUT" -j "$jumps" -l "$len" -s "$SEED" -q "${CAPS[@]}" \
+		-f "$msg" > "$out" 2> "$err"
+
+	stats=$(grep '^stats:' "$err")
+
+	if ! grep -q '^k: ' "$out"; then
+		result=$(sed -n 's/.* stop \([a-z]*\).*/\1/p' <<< "$stats")
+	elif [ "$(sed -n 's/^k: //p' "$out" | head -1)" == "$(cat "$key")" ]; then
+		result=solved
+	else
+		result=found
+	fi
+
+	awk -v name="$name" -v j="$jumps" -v l="$len" -v result="$result" '
+		{
+			for (i = 2; i < NF; i += 2)
+				stat[$i] = $(i + 1);
+			printf "%-36s %2s %4s %-9s %10s %9s %9s %8s %8s\n",
+				name, j, l, result, stat["nodes"], stat["secs"],
+				stat["nodes/s"], stat["first"], stat["rss_kb"];
+		}' <<< "$stats"
+}
+
+printf "%-36s %2s %4s %-9s %10s %9s %9s %8s %8s\n" \
+	corpus j len result nodes secs nodes/s first rss_kb
+
+# checked-in corpora, with the solve times recorded in README.md
+for msg in "$TOP"/brut/brut-j*-k*-t*-msg*.txt; do
+	name=$(basename "$msg")
+	jumps=$(sed 's/^brut-j\([0-9]*\)-.*/\1/' <<< "$name")
+	len=$(sed 's/^brut-j[0-9]*-k\([0-9]*\)-.*/\1/' <<< "$name")
+
+	run "$name" "$jumps" "$len" "${msg/-msg/-key}" "$msg"
+done
+
+# generated corpora: jumps, key length, pairs, seed
+for gen in "2 32 300 7" "2 64 600 7" "3 32 600 7" "4 32 1000 7"; do
+	set -- $gen
+	name="gen-j$1-k$2-t$3-s$4"
+
+	"$GENKPA" -j "$1" -l "$2" -n "$3" -s "$4" \
+		-K "$TMP/$name-key.txt" -o "$TMP/$name-msg.txt"
+
+	run "$name" "$1" "$2" "$TMP/$name-key.txt" "$TMP/$name-msg.txt"
+done
@@ -31,6 +31,7 @@ uint8_t *get_key_body(void *raw)
 int main(int argc, char **argv)
 {
 	struct hx_state *hx;
+	struct hx_state *hx_new = NULL;
 
 	int rc, errflg = 0;
 
@@ -43,6 +44,8 @@ int main(int argc, char **argv)
 	char *arg_S = NULL;
 	char *arg_M = NULL;
 	char *arg_m = NULL;
+	char *arg_N = NULL;
+	char *arg_T = NULL;
 
 	uint8_t *raw_K = NULL;
 	size_t raw_K_len = 0;
@@ -60,16 +63,22 @@ int main(int argc, char **argv)
 	uint8_t *raw_m = NULL;
 	size_t raw_m_len = 0;
 
+	uint8_t *raw_N = NULL;
+	size_t raw_N_len = 0;
+
+	uint8_t *raw_T = NULL;
+
 	char *out_m = NULL;
 	size_t out_m_len = 0;
 
 	opterr = 1;
-	while ((rc = getopt(argc, argv, "DdeK:j:k:l:h:S:M:m:v")) != -1) {
+	while ((rc = getopt(argc, argv, "DdexK:j:k:l:h:S:M:m:N:T:v")) != -1) {
 		switch (rc) {
 
 		case 'D': /* decrypt (plain) */
 		case 'd': /* decrypt (base64) */
 		case 'e': /* encrypt (base64) */
+		case 'x': /* transcrypt (base64) */
 			op = rc;
 			break;
 
@@ -104,6 +113,13 @@ int main(int argc, char **argv)
 			arg_M = NULL;
 			break;
 
+		case 'N': /* new key: base64 (hohha format) */
+			arg_N = optarg;
+			break;
+		case 'T': /* override new salt: eight numeric */
+			arg_T = optarg;
+			break;
+
 		case 'v': /* increase verbosity */
 			++hohha_dbg_level;
 			break;
@@ -115,7 +131,12 @@ int main(int argc, char **argv)
 	}
 
 	if (!op) {
-		fprintf(stderr, "missing one of -c or -d or -e\n");
+		fprintf(stderr, "missing one of -c or -d or -e or -x\n");
+		++errflg;
+	}
+
+	if ((op == 'x') != !!arg_N) {
+		fprintf(stderr, "-N is required with -x, and only -x\n");
 		++errflg;
 	}
 
@@ -155,6 +176,8 @@ int main(int argc, char **argv)
 			"      Decrypt the cyphertext message (base64)\n"
 			"    -e\n"
 			"      Encrypt the plaintext message (base64)\n"
+			"    -x\n"
+			"      Transcrypt the cyphertext message to -N (base64)\n"
 			"\n"
 			"  key: from the following options\n"
 			"    -K <key>\n"
@@ -170,6 +193,12 @@ int main(int argc, char **argv)
 			"    -S <salt>\n"
 			"      Override key salt (eight numeric)\n"
 			"\n"
+			"  new key: for -x\n"
+			"    -N <key>\n"
+			"      Hohha key format (base64)\n"
+			"    -T <salt>\n"
+			"      Override new key salt (eight numeric)\n"
+			"\n"
 			"  message: from the following options\n"
 			"    -M <msg>\n"
 			"      Message (plain)\n"
@@ -215,6 +244,12 @@ int main(int argc, char **argv)
 		if (arg_m)
 			fprintf(stderr, " -m '%s'", arg_m);
 
+		if (arg_N)
+			fprintf(stderr, " -N '%s'", arg_N);
+
+		if (arg_T)
+			fprintf(stderr, " -T '%s'", arg_T);
+
 		fprintf(stderr, "\n");
 	}
 
@@ -330,6 +365,40 @@ int main(int argc, char **argv)
 		b64_decode(arg_m, strlen(arg_m), raw_m, &raw_m_len);
 	}
 
+	if (arg_N) {
+		size_t sz;
+
+		rc = b64_decode(arg_N, strlen(arg_N), NULL, &sz);
+		if (rc || sz < 11) {
+			fprintf(stderr, "invalid -N '%s'\n", arg_N);
+			exit(1);
+		}
+
+		raw_N = malloc(sz);
+		raw_N_len = sz;
+
+		b64_decode(arg_N, strlen(arg_N), raw_N, &raw_N_len);
+
+		if (get_key_len(raw_N) > raw_N_len - 11) {
+			fprintf(stderr, "invalid -N '%s'\n", arg_N);
+			exit(1);
+		}
+	}
+
+	if (arg_T) {
+		raw_T = malloc(8);
+
+		rc = sscanf(arg_T, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu\n",
+		       &raw_T[0], &raw_T[1], &raw_T[2], &raw_T[3],
+		       &raw_T[4], &raw_T[5], &raw_T[6], &raw_T[7]);
+		if (rc != 8) {
+			fprintf(stderr, "invalid -T '%s'\n", arg_T);
+			exit(1);
+		}
+	} else if (raw_N) {
+		raw_T = get_key_salt(raw_N);
+	}
+
 	if (num_l < raw_k_len) {
 		fprintf(stderr, "warning: key length less than key data\n");
 		fprintf(stderr, "    key length: %u\n", num_l);
@@ -354,8 +423,20 @@ int main(int argc, char **argv)
 	if (arg_h)
 		hx->v = num_h;
 
+	if (raw_N) {
+		hx_new = malloc(sizeof(*hx_new) + get_key_len(raw_N));
+
+		hx_init(hx_new, get_key_body(raw_N), get_key_len(raw_N),
+			get_key_jumps(raw_N),
+			*(uint32_t *)(raw_T),
+			*(uint32_t *)(raw_T + 4),
+			0);
+	}
+
 	if (op == 'e')
 		hx_encrypt(hx, raw_m, raw_m, raw_m_len);
+	else if (op == 'x')
+		hx_transcrypt(hx, hx_new, raw_m, raw_m, raw_m_len);
 	else
 		hx_decrypt(hx, raw_m, raw_m, raw_m_len);
 
@@ -0,0 +1,75 @@
+#ifndef HOHHA_H
+#define HOHHA_H
+
+/*
+ * Public interface of libhohha.
+ *
+ * Link with -lhohha, and include only this header.  Symbols not declared
+ * here (or in hohha_xor.h, which this includes) are private to the library.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HOHHA_VERSION_MAJOR 1
+#define HOHHA_VERSION_MINOR 4
+#define HOHHA_VERSION_PATCH 0
+
+#define HOHHA_VERSION ((HOHHA_VERSION_MAJOR << 16) | \
+		       (HOHHA_VERSION_MINOR << 8) | \
+		       (HOHHA_VERSION_PATCH))
+
+#include "hohha_xor.h"
+
+/**
+ * Return the version of the library, as HOHHA_VERSION.
+ *
+ * The major version of the library must match the header.
+ */
+HX_API uint32_t hx_version(void);
+
+/**
+ * Update a hohha-crc with the next byte.
+ *
+ * @crc - running crc, starting from ~0
+ * @word - next byte of data
+ */
+HX_API uint32_t crc32_byte(uint32_t crc, uint8_t word);
+
+/**
+ * Compute the hohha-crc of a block of data.
+ *
+ * @data - data to checksum
+ * @len - length of the data, in bytes
+ */
+HX_API uint32_t crc32_data(uint8_t *data, uint32_t len);
+
+/**
+ * Encode data as base64 text.
+ *
+ * The output is terminated with a null character, which must fit in the
+ * output buffer.  Returns zero, or -1 if the output buffer is too small.
+ *
+ * @data_buf - data to encode
+ * @data_len - length of the data, in bytes
+ * @out_buf - destination buffer for the text
+ * @out_len - length of the destination buffer, in bytes
+ */
+HX_API int b64_encode(const uint8_t* data_buf, size_t data_len,
+		      char* out_buf, size_t out_len);
+
+/**
+ * Decode base64 text as data.
+ *
+ * If the output buffer is NULL, only the decoded length is computed.
+ * Returns zero, or -1 if the text is invalid or the buffer too small.
+ *
+ * @in_buf - text to decode
+ * @in_len - length of the text, in characters
+ * @out_buf - destination buffer for the data, or NULL
+ * @out_len - in: length of the buffer; out: length of the data
+ */
+HX_API int b64_decode(const char *in_buf, size_t in_len,
+		      uint8_t *out_buf, size_t *out_len);
+
+#endif
@@ -0,0 +1,714 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_perf.h"
+
+/*
+ * Benchmark the kernels of the library, over a matrix of parameters.
+ *
+ * Each configuration is a kernel, a variant of the jump function, a number
+ * of jumps, a key length, and a message length.  A sample is the time of a
+ * batch of calls, with enough calls that the batch takes some minimum time,
+ * divided by the number of calls.  After some samples of warmup, the median
+ * and p99 of the samples are reported, with a 95% confidence interval of the
+ * median, by the order statistics of the samples.
+ *
+ * The state is initialized once for each configuration, and each call
+ * continues the same stream, so the time is only of the kernel.
+ *
+ * With hardware counters, the measured samples are one region, and the
+ * counts are reported per byte of message, with the instructions per cycle.
+ */
+
+enum hxbm_kern {
+	HXBM_ENCRYPT,			/* hx_encrypt */
+	HXBM_DECRYPT,			/* hx_decrypt */
+	HXBM_CRC32,			/* crc32_data */
+	HXBM_B64_ENC,			/* b64_encode */
+	HXBM_B64_DEC,			/* b64_decode */
+	HXBM_KERNS,
+};
+
+static const char *hxbm_kern_name[HXBM_KERNS] = {
+	"encrypt", "decrypt", "crc32", "b64enc", "b64dec",
+};
+
+struct hxbm_variant {
+	const char *name;
+	uint32_t opt;
+};
+
+static const struct hxbm_variant hxbm_variants[] = {
+	{ "opt", 0 },
+	{ "any", HX_OPT_JUMP_ANY },
+	{ "each", HX_OPT_JUMP_N },
+};
+
+#define HXBM_VARIANTS (sizeof(hxbm_variants) / sizeof(*hxbm_variants))
+
+/* most values in each list of the matrix */
+#define HXBM_LIST_MAX 64
+
+enum hxbm_fmt {
+	HXBM_FMT_TEXT,
+	HXBM_FMT_CSV,
+	HXBM_FMT_JSON,
+};
+
+struct hxbm_run {
+	enum hxbm_kern kern;		/* kernel to time */
+	const struct hxbm_variant *var;	/* variant of the jump function */
+	uint32_t key_jumps;		/* number of jumps */
+	uint32_t key_len;		/* length of the key body */
+	uint32_t msg_len;		/* length of each message */
+	struct hx_state *hx;		/* state, continued by each call */
+	uint8_t *in;			/* input message */
+	uint8_t *out;			/* output message */
+	char *text;			/* base64 of the message */
+	size_t text_len;		/* length of the base64 buffer */
+	size_t text_used;		/* length of the base64, untimed */
+};
+
+struct hxbm_res {
+	uint64_t batch;			/* calls per sample */
+	double median;			/* ns per call */
+	double ci_lo;			/* 95% confidence of the median */
+	double ci_hi;
+	double p99;			/* ns per call */
+	struct hxp_sample perf;		/* counters of the samples */
+};
+
+struct hxbm_opts {
+	uint32_t samples;		/* samples of each configuration */
+	uint32_t warmup;		/* samples before measuring */
+	uint64_t min_ns;		/* minimum time of a sample */
+	enum hxbm_fmt fmt;		/* output format */
+	const char *label;		/* label of every result */
+	int cpu;			/* pinned cpu, or negative */
+	uint64_t seed;			/* seed of keys and messages */
+	unsigned rows;			/* results printed */
+	struct hxp_ctr *perf;		/* counters, or NULL */
+};
+
+/* results of the kernels, so they are not optimized away */
+static volatile uint32_t hxbm_sink;
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint64_t hxbm_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void hxbm_once(struct hxbm_run *run)
+{
+	size_t len;
+
+	switch (run->kern) {
+	case HXBM_ENCRYPT:
+		hx_encrypt(run->hx, run->in, run->out, run->msg_len);
+		break;
+	case HXBM_DECRYPT:
+		hx_decrypt(run->hx, run->in, run->out, run->msg_len);
+		break;
+	case HXBM_CRC32:
+		hxbm_sink = crc32_data(run->in, run->msg_len);
+		break;
+	case HXBM_B64_ENC:
+		hxbm_sink = b64_encode(run->in, run->msg_len,
+				       run->text, run->text_len);
+		break;
+	case HXBM_B64_DEC:
+		len = run->msg_len;
+		hxbm_sink = b64_decode(run->text, run->text_used,
+				       run->out, &len);
+		break;
+	default:
+		break;
+	}
+}
+
+static uint64_t hxbm_batch(struct hxbm_run *run, uint64_t batch)
+{
+	uint64_t i, t = hxbm_now();
+
+	for (i = 0; i < batch; ++i)
+		hxbm_once(run);
+
+	return hxbm_now() - t;
+}
+
+static int hxbm_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void hxbm_measure(struct hxbm_run *run, struct hxbm_opts *o,
+			 struct hxbm_res *res)
+{
+	double *ns = malloc(o->samples * sizeof(*ns));
+	uint64_t batch = 1;
+	uint32_t i, lo, hi;
+	double half;
+
+	/* calls per sample, so that a sample takes the minimum time */
+	while (hxbm_batch(run, batch) < o->min_ns && batch < (1ull << 40))
+		batch <<= 1;
+
+	for (i = 0; i < o->warmup; ++i)
+		hxbm_batch(run, batch);
+
+	memset(&res->perf, 0, sizeof(res->perf));
+	if (o->perf)
+		hxp_begin(o->perf, &res->perf);
+
+	for (i = 0; i < o->samples; ++i)
+		ns[i] = (double)hxbm_batch(run, batch) / batch;
+
+	if (o->perf)
+		hxp_end(o->perf, &res->perf);
+
+	qsort(ns, o->samples, sizeof(*ns), hxbm_cmp);
+
+	/* ranks of the median, within 1.96 standard deviations */
+	half = 0.98 * sqrt(o->samples);
+	lo = (uint32_t)fmax(0, floor(o->samples / 2.0 - half));
+	hi = (uint32_t)fmin(o->samples - 1, ceil(o->samples / 2.0 + half));
+
+	res->batch = batch;
+	res->median = o->samples & 1 ? ns[o->samples / 2] :
+		(ns[o->samples / 2 - 1] + ns[o->samples / 2]) / 2;
+	res->ci_lo = ns[lo];
+	res->ci_hi = ns[hi];
+	res->p99 = ns[(uint32_t)ceil(o->samples * 0.99) - 1];
+
+	free(ns);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxbm_print_head(struct hxbm_opts *o)
+{
+	char version[32];
+	int i;
+
+	snprintf(version, sizeof(version), "%u.%u.%u", hx_version() >> 16,
+		 u8(hx_version() >> 8), u8(hx_version()));
+
+	switch (o->fmt) {
+	case HXBM_FMT_TEXT:
+		printf("# version %s label %s cpu %d samples %u warmup %u\n",
+		       version, o->label, o->cpu, o->samples, o->warmup);
+		printf("%-7s %-4s %3s %9s %10s %8s %12s %25s %12s %9s %10s",
+		       "kernel", "var", "j", "key", "msg", "batch",
+		       "median ns", "95% ci ns", "p99 ns", "ns/B", "MB/s");
+		if (o->perf)
+			printf(" %5s", "ipc");
+		for (i = 0; i < HXP_EVENTS && o->perf; ++i)
+			printf(" %10s/B", hxp_name(i));
+		printf("\n");
+		break;
+	case HXBM_FMT_CSV:
+		printf("label,version,cpu,kernel,variant,jumps,key_len,"
+		       "msg_len,samples,batch,median_ns,ci_lo_ns,ci_hi_ns,"
+		       "p99_ns,ns_per_byte,mb_per_s");
+		if (o->perf)
+			printf(",ipc");
+		for (i = 0; i < HXP_EVENTS && o->perf; ++i)
+			printf(",%s_per_byte", hxp_name(i));
+		printf("\n");
+		break;
+	case HXBM_FMT_JSON:
+		printf("{\"label\":\"%s\",\"version\":\"%s\",\"cpu\":%d,"
+		       "\"samples\":%u,\"warmup\":%u,\"results\":[",
+		       o->label, version, o->cpu, o->samples, o->warmup);
+		break;
+	}
+}
+
+/* counters per byte, or nothing for a counter that is not available */
+static void hxbm_print_perf(struct hxbm_opts *o, struct hxbm_run *run,
+			    struct hxbm_res *res)
+{
+	uint64_t bytes = res->batch * o->samples * run->msg_len;
+	double val;
+	int i;
+
+	for (i = -1; i < HXP_EVENTS; ++i) {
+		if (i < 0)
+			val = hxp_ipc(&res->perf);
+		else
+			val = hxp_per(&res->perf, i, bytes);
+
+		switch (o->fmt) {
+		case HXBM_FMT_TEXT:
+			if (val < 0)
+				printf(i < 0 ? " %5s" : " %12s", "-");
+			else
+				printf(i < 0 ? " %5.2f" : " %12.3f", val);
+			break;
+		case HXBM_FMT_CSV:
+			if (val < 0)
+				printf(",");
+			else
+				printf(",%.4f", val);
+			break;
+		case HXBM_FMT_JSON:
+			printf(",\"%s%s\":", i < 0 ? "ipc" : hxp_name(i),
+			       i < 0 ? "" : "_per_byte");
+			if (val < 0)
+				printf("null");
+			else
+				printf("%.4f", val);
+			break;
+		}
+	}
+}
+
+static void hxbm_print_row(struct hxbm_opts *o, struct hxbm_run *run,
+			   struct hxbm_res *res)
+{
+	const char *var = run->var ? run->var->name : "-";
+	uint32_t len = run->msg_len ? run->msg_len : 1;
+	double per_byte = res->median / len;
+	double mb_s = res->median > 0 ? 1e3 * run->msg_len / res->median : 0;
+
+	switch (o->fmt) {
+	case HXBM_FMT_TEXT:
+		printf("%-7s %-4s %3u %9u %10u %8" PRIu64
+		       " %12.1f [%10.1f, %10.1f] %12.1f %9.3f %10.1f",
+		       hxbm_kern_name[run->kern], var, run->key_jumps,
+		       run->key_len, run->msg_len, res->batch, res->median,
+		       res->ci_lo, res->ci_hi, res->p99, per_byte, mb_s);
+		break;
+	case HXBM_FMT_CSV:
+		printf("%s,%u.%u.%u,%d,%s,%s,%u,%u,%u,%u,%" PRIu64
+		       ",%.1f,%.1f,%.1f,%.1f,%.4f,%.2f",
+		       o->label, hx_version() >> 16, u8(hx_version() >> 8),
+		       u8(hx_version()), o->cpu, hxbm_kern_name[run->kern],
+		       var, run->key_jumps, run->key_len, run->msg_len,
+		       o->samples, res->batch, res->median, res->ci_lo,
+		       res->ci_hi, res->p99, per_byte, mb_s);
+		break;
+	case HXBM_FMT_JSON:
+		printf("%s\n{\"kernel\":\"%s\",\"variant\":\"%s\","
+		       "\"jumps\":%u,\"key_len\":%u,\"msg_len\":%u,"
+		       "\"batch\":%" PRIu64 ",\"median_ns\":%.1f,"
+		       "\"ci_lo_ns\":%.1f,\"ci_hi_ns\":%.1f,\"p99_ns\":%.1f,"
+		       "\"ns_per_byte\":%.4f,\"mb_per_s\":%.2f",
+		       o->rows ? "," : "", hxbm_kern_name[run->kern], var,
+		       run->key_jumps, run->key_len, run->msg_len, res->batch,
+		       res->median, res->ci_lo, res->ci_hi, res->p99,
+		       per_byte, mb_s);
+		break;
+	}
+
+	if (o->perf)
+		hxbm_print_perf(o, run, res);
+
+	if (o->fmt == HXBM_FMT_JSON)
+		printf("}");
+	else
+		printf("\n");
+
+	++o->rows;
+	fflush(stdout);
+}
+
+static void hxbm_print_tail(struct hxbm_opts *o)
+{
+	if (o->fmt == HXBM_FMT_JSON)
+		printf("\n]}\n");
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* number with an optional suffix: k, M, or G */
+static uint64_t hxbm_arg_num(char *arg, char opt, uint64_t min, uint64_t max)
+{
+	unsigned long long val;
+	char *end;
+
+	errno = 0;
+	val = strtoull(arg, &end, 0);
+
+	switch (*end) {
+	case 'k': case 'K': val <<= 10; ++end; break;
+	case 'M': val <<= 20; ++end; break;
+	case 'G': val <<= 30; ++end; break;
+	}
+
+	if (errno || end == arg || *end || val < min || val > max) {
+		fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+		exit(1);
+	}
+
+	return val;
+}
+
+/*
+ * List of numbers, as <num>[,<num>...], where each may also be a range
+ * <min>:<max> of each power of two times the min.
+ */
+static uint32_t hxbm_arg_list(char *arg, char opt, uint64_t min, uint64_t max,
+			      uint64_t *list)
+{
+	char *dup = strdup(arg), *tok, *save, *sep;
+	uint64_t lo, hi;
+	uint32_t count = 0;
+
+	for (tok = strtok_r(dup, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		sep = strchr(tok, ':');
+		if (sep)
+			*sep = 0;
+
+		lo = hxbm_arg_num(tok, opt, min, max);
+		hi = sep ? hxbm_arg_num(sep + 1, opt, lo, max) : lo;
+
+		for (; lo <= hi; lo <<= 1) {
+			if (count == HXBM_LIST_MAX) {
+				fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+				exit(1);
+			}
+			list[count++] = lo;
+			if (!lo)
+				break;
+		}
+	}
+
+	free(dup);
+
+	if (!count) {
+		fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+		exit(1);
+	}
+
+	return count;
+}
+
+/* list of names, as a mask of their index */
+static uint32_t hxbm_arg_names(char *arg, char opt, const char *const *names,
+			       size_t stride, uint32_t count)
+{
+	char *dup = strdup(arg), *tok, *save;
+	uint32_t i, mask = 0;
+
+	for (tok = strtok_r(dup, ",", &save); tok;
+	     tok = strtok_r(NULL, ",", &save)) {
+		for (i = 0; i < count; ++i)
+			if (!strcmp(tok, *(const char *const *)
+				    ((const char *)names + i * stride)))
+				break;
+
+		if (i == count) {
+			fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+			exit(1);
+		}
+
+		mask |= 1u << i;
+	}
+
+	free(dup);
+
+	return mask;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxbm_run_msg(struct hxbm_opts *o, struct hxbm_run *run,
+			 uint64_t *seed)
+{
+	struct hxbm_res res;
+	size_t text_len;
+
+	run->in = malloc(run->msg_len + 1);
+	run->out = malloc(run->msg_len + 1);
+	splitmix64_fill(seed, run->in, run->msg_len);
+
+	text_len = ((size_t)run->msg_len * 4 / 3 + 3) & ~(size_t)3;
+	run->text_len = text_len + 1;
+	run->text = malloc(run->text_len);
+	b64_encode(run->in, run->msg_len, run->text, run->text_len);
+	run->text_used = strlen(run->text);
+
+	hxbm_measure(run, o, &res);
+	hxbm_print_row(o, run, &res);
+
+	free(run->in);
+	free(run->out);
+	free(run->text);
+}
+
+int main(int argc, char **argv)
+{
+	struct hxbm_opts o;
+	struct hxbm_run run;
+	uint64_t seed;
+	uint8_t *key;
+	cpu_set_t cpus;
+	struct hxp_ctr perf;
+	int opt_P = 0;
+
+	int rc, errflg = 0;
+
+	char *arg_j = "2,3,4,8,16,64";
+	char *arg_l = "64,4k,1M,16M";
+	char *arg_m = "1,64,4k,1M";
+	char *arg_V = "opt,any,each";
+	char *arg_k = "encrypt,decrypt,crc32,b64enc,b64dec";
+	char *arg_o = "text";
+	char *arg_c = NULL;
+
+	uint64_t list_j[HXBM_LIST_MAX];
+	uint64_t list_l[HXBM_LIST_MAX];
+	uint64_t list_m[HXBM_LIST_MAX];
+	uint32_t num_j, num_l, num_m;
+	uint32_t mask_V, mask_k;
+	uint32_t j, l, m, v, k;
+
+	memset(&o, 0, sizeof(o));
+	o.samples = 21;
+	o.warmup = 3;
+	o.min_ns = 1000000;
+	o.label = "";
+	o.seed = 1;
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "j:l:m:V:k:n:w:q:c:o:L:s:Pv")) != -1) {
+		switch (rc) {
+		case 'j': /* jumps: list */
+			arg_j = optarg;
+			break;
+		case 'l': /* key lengths: list */
+			arg_l = optarg;
+			break;
+		case 'm': /* message lengths: list */
+			arg_m = optarg;
+			break;
+		case 'V': /* variants: names */
+			arg_V = optarg;
+			break;
+		case 'k': /* kernels: names */
+			arg_k = optarg;
+			break;
+
+		case 'n': /* samples: numeric */
+			o.samples = hxbm_arg_num(optarg, 'n', 1, 1u << 20);
+			break;
+		case 'w': /* warmup samples: numeric */
+			o.warmup = hxbm_arg_num(optarg, 'w', 0, 1u << 20);
+			break;
+		case 'q': /* minimum sample time: usec */
+			o.min_ns = hxbm_arg_num(optarg, 'q', 0, 1u << 30) * 1000;
+			break;
+		case 'c': /* pin to cpu: numeric, or -1 */
+			arg_c = optarg;
+			break;
+
+		case 'o': /* output format: string */
+			arg_o = optarg;
+			break;
+		case 'L': /* label of results: string */
+			o.label = optarg;
+			break;
+		case 's': /* seed: numeric */
+			o.seed = hxbm_arg_num(optarg, 's', 0, UINT64_MAX);
+			break;
+		case 'P': /* hardware counters */
+			opt_P = 1;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s <matrix> <options> [-v]\n"
+			"\n"
+			"  Lists are <num>[,<num>...], or <min>:<max> for each\n"
+			"  power of two times min.  Numbers may have a suffix,\n"
+			"  k, M or G.\n"
+			"\n"
+			"  Matrix:\n"
+			"    -j <list>\n"
+			"      Number of jumps (default: 2,3,4,8,16,64)\n"
+			"    -l <list>\n"
+			"      Key lengths, powers of two (default: 64,4k,1M,16M)\n"
+			"    -m <list>\n"
+			"      Message lengths, up to 1G (default: 1,64,4k,1M)\n"
+			"    -V <names>\n"
+			"      Variants of the jump function (default: opt,any,each)\n"
+			"    -k <names>\n"
+			"      Kernels (default: encrypt,decrypt,crc32,b64enc,b64dec)\n"
+			"\n"
+			"  Options:\n"
+			"    -n <samples>\n"
+			"      Samples of each configuration (default: 21)\n"
+			"    -w <samples>\n"
+			"      Samples of warmup, not measured (default: 3)\n"
+			"    -q <usec>\n"
+			"      Minimum time of a sample (default: 1000)\n"
+			"    -c <cpu>\n"
+			"      Pin to a cpu, or -1 not to pin (default: current cpu)\n"
+			"    -o <format>\n"
+			"      Output format: text, csv, or json (default: text)\n"
+			"    -L <label>\n"
+			"      Label of each result, like a commit id\n"
+			"    -s <seed>\n"
+			"      Seed of keys and messages (default: 1)\n"
+			"    -P\n"
+			"      Count cycles, instructions, branch and cache misses\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	num_j = hxbm_arg_list(arg_j, 'j', 2, 1024, list_j);
+	num_l = hxbm_arg_list(arg_l, 'l', 1, 1u << 31, list_l);
+	num_m = hxbm_arg_list(arg_m, 'm', 1, 1u << 30, list_m);
+
+	for (l = 0; l < num_l; ++l) {
+		if (!is_pow2(list_l[l])) {
+			fprintf(stderr, "invalid -l '%s'\n", arg_l);
+			exit(1);
+		}
+	}
+
+	mask_V = hxbm_arg_names(arg_V, 'V', &hxbm_variants[0].name,
+				sizeof(*hxbm_variants), HXBM_VARIANTS);
+	mask_k = hxbm_arg_names(arg_k, 'k', hxbm_kern_name,
+				sizeof(*hxbm_kern_name), HXBM_KERNS);
+
+	if (!strcmp(arg_o, "text")) {
+		o.fmt = HXBM_FMT_TEXT;
+	} else if (!strcmp(arg_o, "csv")) {
+		o.fmt = HXBM_FMT_CSV;
+	} else if (!strcmp(arg_o, "json")) {
+		o.fmt = HXBM_FMT_JSON;
+	} else {
+		fprintf(stderr, "invalid -o '%s'\n", arg_o);
+		exit(1);
+	}
+
+	o.cpu = sched_getcpu();
+	if (arg_c) {
+		errno = 0;
+		o.cpu = strtol(arg_c, NULL, 0);
+		if (errno || o.cpu < -1 || o.cpu >= CPU_SETSIZE) {
+			fprintf(stderr, "invalid -c '%s'\n", arg_c);
+			exit(1);
+		}
+	}
+
+	if (o.cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(o.cpu, &cpus);
+		if (sched_setaffinity(0, sizeof(cpus), &cpus)) {
+			pr("cannot pin to cpu %d: %s\n", o.cpu, strerror(errno));
+			o.cpu = -1;
+		}
+	}
+
+	/* after pinning, so the counters stay on one cpu */
+	if (opt_P) {
+		if (!hxp_open(&perf))
+			pr("hardware counters not available\n");
+		o.perf = &perf;
+	}
+
+	hxbm_print_head(&o);
+
+	/* kernels of the library, without a key */
+	for (k = HXBM_CRC32; k < HXBM_KERNS; ++k) {
+		if (!(mask_k & (1u << k)))
+			continue;
+
+		for (m = 0; m < num_m; ++m) {
+			memset(&run, 0, sizeof(run));
+			run.kern = k;
+			run.msg_len = list_m[m];
+
+			seed = o.seed;
+			hxbm_run_msg(&o, &run, &seed);
+		}
+	}
+
+	/* kernels of the algorithm, with each key */
+	for (l = 0; l < num_l; ++l) {
+		key = malloc(list_l[l]);
+		seed = o.seed;
+		splitmix64_fill(&seed, key, list_l[l]);
+
+		for (k = HXBM_ENCRYPT; k <= HXBM_DECRYPT; ++k) {
+			if (!(mask_k & (1u << k)))
+				continue;
+
+			for (j = 0; j < num_j; ++j) {
+				for (v = 0; v < HXBM_VARIANTS; ++v) {
+					if (!(mask_V & (1u << v)))
+						continue;
+
+					memset(&run, 0, sizeof(run));
+					run.kern = k;
+					run.var = &hxbm_variants[v];
+					run.key_jumps = list_j[j];
+					run.key_len = list_l[l];
+					run.hx = malloc(hx_size(run.key_len));
+
+					for (m = 0; m < num_m; ++m) {
+						hx_init(run.hx, key, run.key_len,
+							run.key_jumps,
+							u32(seed), u32(seed >> 32),
+							run.var->opt);
+
+						run.msg_len = list_m[m];
+						hxbm_run_msg(&o, &run, &seed);
+					}
+
+					free(run.hx);
+				}
+			}
+		}
+
+		free(key);
+	}
+
+	hxbm_print_tail(&o);
+
+	if (o.perf)
+		hxp_close(o.perf);
+
+	return 0;
+}
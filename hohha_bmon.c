@@ -0,0 +1,128 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_util.h"
+#include "hohha_bstat.h"
+
+int main(int argc, char **argv)
+{
+	int rc, errflg = 0;
+
+	char *arg_M = NULL;
+	char *arg_i = NULL;
+	char *arg_n = NULL;
+
+	double secs = 0;
+	unsigned long count = 1, i;
+
+	struct hxbs_page *shm;
+	struct hxbs_page page;
+	struct timespec ts;
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "M:i:n:v")) != -1) {
+		switch (rc) {
+		case 'M': /* shared page: name */
+			arg_M = optarg;
+			break;
+
+		case 'i': /* interval: seconds */
+			arg_i = optarg;
+			break;
+		case 'n': /* count: numeric */
+			arg_n = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_M) {
+		fprintf(stderr, "missing one of the required options\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s -M <name> [-i <seconds>] [-n <count>] [-v]\n"
+			"\n"
+			"  Print the search counters of hohha_brut -M, as json.\n"
+			"\n"
+			"  Options:\n"
+			"    -M <name>\n"
+			"      Shared page of hohha_brut -M (required)\n"
+			"    -i <seconds>\n"
+			"      Print again after an interval (default: once)\n"
+			"    -n <count>\n"
+			"      Print so many times (default: 1, or forever with -i)\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	if (arg_i) {
+		char *end;
+
+		errno = 0;
+		secs = strtod(arg_i, &end);
+		if (errno || *end || !(secs > 0)) {
+			fprintf(stderr, "invalid -i '%s'\n", arg_i);
+			exit(1);
+		}
+
+		count = 0;
+	}
+
+	if (arg_n) {
+		errno = 0;
+		count = strtoul(arg_n, NULL, 0);
+		if (errno || !count) {
+			fprintf(stderr, "invalid -n '%s'\n", arg_n);
+			exit(1);
+		}
+	}
+
+	shm = hxbs_shm_open(arg_M);
+	if (!shm) {
+		fprintf(stderr, "invalid -M '%s'\n", arg_M);
+		exit(1);
+	}
+
+	ts.tv_sec = (time_t)secs;
+	ts.tv_nsec = (long)((secs - ts.tv_sec) * 1e9);
+
+	for (i = 0; !count || i < count; ++i) {
+		if (i)
+			nanosleep(&ts, NULL);
+
+		if (hxbs_shm_read(shm, &page)) {
+			fprintf(stderr, "no counters in '%s'\n", arg_M);
+			exit(1);
+		}
+
+		hxbs_json(stdout, &page);
+		printf("\n");
+		fflush(stdout);
+	}
+
+	return 0;
+}
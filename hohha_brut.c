@@ -1,13 +1,25 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 
 #include "hohha_xor.h"
 #include "hohha_util.h"
+#include "hohha_kpa.h"
+#include "hohha_perf.h"
+#include "hohha_bstat.h"
 
 static int hxb_dbg_level;
 
@@ -20,15 +32,366 @@ static void catch_sigusr1(int sig)
 
 /* --- --- --- --- --- --- --- --- --- */
 
+/* check the time limit in one node of so many */
+#define HXB_TIME_EVERY 4096
+
+/* nodes taken at a time by a thread, from the nodes of the search */
+#define HXB_NODES_CHUNK 4096
+
+static uint64_t hxb_nodes;		/* nodes of the search, or taken */
+static uint64_t hxb_max_nodes;		/* stop after so many nodes, or zero */
+static double hxb_max_secs;		/* stop after so many seconds, or zero */
+static int hxb_quit_first;		/* stop at the first solution */
+static int hxb_stop;			/* the search was stopped */
+static const char *hxb_stop_why = "exhausted";
+static uint64_t hxb_solutions;		/* solutions found */
+static double hxb_first_secs = -1;	/* time of the first solution */
+static struct timespec hxb_ts_start;	/* start of the search */
+
+static __thread uint64_t hxb_nodes_left; /* nodes taken, not yet expanded */
+
+/* solutions and progress are printed whole, by one thread at a time */
+static pthread_mutex_t hxb_out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int hxb_stopped(void)
+{
+	return __atomic_load_n(&hxb_stop, __ATOMIC_RELAXED);
+}
+
+/* stop the search, for the first reason only */
+static void hxb_stop_set(const char *why)
+{
+	int stop = 0;
+
+	if (__atomic_compare_exchange_n(&hxb_stop, &stop, 1, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		hxb_stop_why = why;
+}
+
+/* take nodes to expand, up to the limit, or nonzero at the limit */
+static int hxb_nodes_take(void)
+{
+	uint64_t nodes, take;
+
+	nodes = __atomic_load_n(&hxb_nodes, __ATOMIC_RELAXED);
+	do {
+		take = HXB_NODES_CHUNK;
+		if (hxb_max_nodes) {
+			if (nodes >= hxb_max_nodes)
+				return -1;
+			if (take > hxb_max_nodes - nodes)
+				take = hxb_max_nodes - nodes;
+		}
+	} while (!__atomic_compare_exchange_n(&hxb_nodes, &nodes, nodes + take,
+					      1, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	hxb_nodes_left = take;
+
+	return 0;
+}
+
+/* give back the nodes not expanded, at the end of a thread */
+static void hxb_nodes_give(void)
+{
+	__atomic_fetch_sub(&hxb_nodes, hxb_nodes_left, __ATOMIC_RELAXED);
+	hxb_nodes_left = 0;
+}
+
+static double hxb_secs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (ts.tv_sec - hxb_ts_start.tv_sec) +
+		(ts.tv_nsec - hxb_ts_start.tv_nsec) * 1e-9;
+}
+
+static void hxb_stats_show(FILE *f)
+{
+	struct rusage ru;
+	double secs = hxb_secs();
+	char first[32] = "-";
+
+	getrusage(RUSAGE_SELF, &ru);
+
+	if (hxb_first_secs >= 0)
+		snprintf(first, sizeof(first), "%.3f", hxb_first_secs);
+
+	fprintf(f, "stats: nodes %" PRIu64 " secs %.3f nodes/s %.0f"
+		" solutions %" PRIu64 " first %s rss_kb %ld stop %s\n",
+		hxb_nodes, secs, secs > 0 ? hxb_nodes / secs : 0,
+		hxb_solutions, first, ru.ru_maxrss, hxb_stop_why);
+}
+
+/* sample the advance of one node in so many */
+#define HXB_PERF_EVERY 256
+
+static __thread struct hxp_ctr *hxb_perf; /* hardware counters, or NULL */
+static struct hxp_sample hxb_perf_read;	/* reading the corpus */
+static struct hxp_sample hxb_perf_search; /* the whole search */
+static struct hxp_sample hxb_perf_adv;	/* advancing positions, sampled */
+static uint64_t hxb_perf_bytes;		/* bytes of the corpus */
+
+/* counters of the first thread, and its nodes */
+static void hxb_perf_show(FILE *f, uint64_t nodes)
+{
+	fprintf(f, "nodes: %" PRIu64 "\n", nodes);
+	hxp_show(f, "read", &hxb_perf_read, hxb_perf_bytes, "B");
+	hxp_show(f, "search", &hxb_perf_search, nodes, "node");
+	hxp_show(f, "adv", &hxb_perf_adv, hxb_perf_adv.regions, "node");
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* publish the shared page every so many seconds */
+#define HXB_BSTAT_SECS 1.0
+
+#define HXB_BSTAT_MAX 256
+
+static struct hxbs_page *hxb_bstat_list[HXB_BSTAT_MAX];
+static uint32_t hxb_bstat_count;
+static pthread_mutex_t hxb_bstat_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread struct hxbs_page *hxb_bstat;	/* counters of this thread */
+static __thread uint32_t hxb_depth;		/* depth of this thread */
+
+static int hxb_bstat_time;		/* time the nodes of each depth */
+static FILE *hxb_bstat_json;		/* print json, or NULL */
+static struct hxbs_page *hxb_bstat_shm;	/* shared page, or NULL */
+static double hxb_bstat_next;		/* time to publish the page */
+static pthread_mutex_t hxb_bstat_pub_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hxb_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* counters of the calling thread, until the end of the search */
+static void hxb_bstat_new(void)
+{
+	struct hxbs_page *st;
+
+	st = calloc(1, sizeof(*st));
+	if (!st) {
+		pr("out of memory\n");
+		exit(1);
+	}
+
+	st->threads = 1;
+
+	pthread_mutex_lock(&hxb_bstat_lock);
+	if (hxb_bstat_count == HXB_BSTAT_MAX) {
+		pr("too many threads\n");
+		exit(1);
+	}
+	hxb_bstat_list[hxb_bstat_count++] = st;
+	pthread_mutex_unlock(&hxb_bstat_lock);
+
+	hxb_bstat = st;
+}
+
+/* finish the page of one thread, for export */
+static void hxb_bstat_fix(struct hxbs_page *st)
+{
+	st->magic = HXBS_MAGIC;
+	st->version = HXBS_VERSION;
+	st->pid = getpid();
+	st->ns = (uint64_t)(hxb_secs() * 1e9);
+	st->depth_count = st->depth_max + 1;
+	if (st->depth_count > HXBS_DEPTH)
+		st->depth_count = HXBS_DEPTH;
+}
+
+/* add the counters of every thread, which may be running */
+static void hxb_bstat_sum(struct hxbs_page *sum)
+{
+	struct hxbs_page *st;
+	uint32_t i, d;
+
+	memset(sum, 0, sizeof(*sum));
+
+	pthread_mutex_lock(&hxb_bstat_lock);
+	for (i = 0; i < hxb_bstat_count; ++i) {
+		st = hxb_bstat_list[i];
+
+		sum->threads += st->threads;
+		sum->nodes += st->nodes;
+		sum->solutions += st->solutions;
+		sum->pos_adv += st->pos_adv;
+		sum->bytes += st->bytes;
+		sum->dup_bytes += st->dup_bytes;
+		sum->undo_bytes += st->undo_bytes;
+
+		if (sum->depth_max < st->depth_max)
+			sum->depth_max = st->depth_max;
+
+		for (d = 0; d < HXBS_DEPTH; ++d) {
+			sum->depth[d].nodes += st->depth[d].nodes;
+			sum->depth[d].backtracks += st->depth[d].backtracks;
+			sum->depth[d].v_branches += st->depth[d].v_branches;
+			sum->depth[d].m_branches += st->depth[d].m_branches;
+			sum->depth[d].ns += st->depth[d].ns;
+		}
+	}
+	pthread_mutex_unlock(&hxb_bstat_lock);
+
+	hxb_bstat_fix(sum);
+}
+
+/* one json object: the sum, and each thread */
+static void hxb_bstat_show(FILE *f)
+{
+	struct hxbs_page page;
+	uint32_t i;
+
+	hxb_bstat_sum(&page);
+
+	fprintf(f, "{\"total\":");
+	hxbs_json(f, &page);
+	fprintf(f, ",\"threads\":[");
+
+	pthread_mutex_lock(&hxb_bstat_lock);
+	for (i = 0; i < hxb_bstat_count; ++i) {
+		memcpy(&page, hxb_bstat_list[i], sizeof(page));
+		hxb_bstat_fix(&page);
+
+		fprintf(f, "%s\n", i ? "," : "");
+		hxbs_json(f, &page);
+	}
+	pthread_mutex_unlock(&hxb_bstat_lock);
+
+	fprintf(f, "]}\n");
+	fflush(f);
+}
+
+/* publish the page, by one thread at a time, at the time or if forced */
+static void hxb_bstat_publish(double secs, int force)
+{
+	struct hxbs_page page;
+
+	if (force)
+		pthread_mutex_lock(&hxb_bstat_pub_lock);
+	else if (pthread_mutex_trylock(&hxb_bstat_pub_lock))
+		return;
+
+	if (force || secs >= hxb_bstat_next) {
+		hxb_bstat_next = secs + HXB_BSTAT_SECS;
+		hxb_bstat_sum(&page);
+		hxbs_shm_publish(hxb_bstat_shm, &page);
+	}
+
+	pthread_mutex_unlock(&hxb_bstat_pub_lock);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* the bytes of a step: known plaintext, and its xor with the ciphertext */
+struct hxb_byte {
+	uint8_t mesg;			/* cleartext byte */
+	uint8_t x;			/* cleartext xor ciphertext byte */
+};
+
+/*
+ * The corpus, read only, and shared by each copy of a context.  The bytes
+ * of every message are packed in one arena, in order of the positions.
+ */
+struct hxb_text {
+	uint32_t *s1;			/* original s1 */
+	uint32_t *s2;			/* original s2 */
+	uint32_t *len;			/* length of message */
+	struct hxb_byte **text;		/* bytes of message, in the arena */
+	struct hxb_byte *arena;		/* bytes of every message */
+};
+
+/*
+ * The running state of the positions, by field, in one block.  Position i
+ * is at index i of each array.
+ */
 struct hxb_pos {
-	uint32_t s1;			/* original s1 */
-	uint32_t s2;			/* original s2 */
-	struct hx_state *hx;		/* running state */
-	uint8_t *mesg;			/* cleartext message */
-	uint8_t *ciph;			/* ciphertext message */
-	size_t len;			/* length of message */
-	size_t idx;			/* current step */
-	size_t jmp;			/* current jump */
+	uint32_t *s1;
+	uint32_t *s2;
+	uint32_t *m;
+	uint32_t *v;
+	uint32_t *cs;
+	uint32_t *idx;			/* current step */
+	uint32_t *jmp;			/* current jump */
+	uint32_t *next;			/* next in its wait list */
+};
+
+/*
+ * The key bytes written by the jumps of the positions.  A position reads
+ * the guessed original key, except at the bytes its own jumps have written,
+ * which are kept here, by position and key index, in a table of open
+ * addressing with linear probing.
+ */
+struct hxb_over_ent {
+	uint32_t slot;			/* i * sz_key + m + 1, or zero if free */
+	uint8_t x;			/* key byte written */
+};
+
+/* entries of the table at first, a power of two */
+#define HXB_OVER_MIN 1024
+
+struct hxb_over {
+	struct hxb_over_ent *ent;
+	uint32_t mask;			/* number of entries, minus one */
+	uint32_t count;			/* entries used */
+};
+
+/*
+ * The guessed bits: of v, and a bit for each key byte.  With the positions
+ * at each key byte, and a tree of which key byte not guessed has the most
+ * positions: a leaf for each byte, and each node has the byte of the most
+ * of its children, the first if equal, so the byte to guess is at the root.
+ *
+ * Positions move in every node, and mostly move back when it backtracks,
+ * but the byte to guess is needed only where a node branches.  So a move
+ * only counts, and marks the byte, and the tree is fixed over the bytes
+ * marked when the byte to guess is needed.
+ */
+struct hxb_mask {
+	uint32_t v;			/* bits of v guessed */
+	uint64_t *key;			/* key bytes guessed */
+	uint64_t *dirty;		/* bytes changed, since the tree was fixed */
+	uint32_t *dirty_m;		/* bytes changed, in order */
+	uint32_t dirty_count;
+	uint32_t *count;		/* positions at each key byte */
+	uint32_t *tree;			/* byte with the most, of each subtree */
+};
+
+/* no position, at the end of a wait list */
+#define HXB_WAIT_NONE UINT32_MAX
+
+/*
+ * The positions waiting for a guess, in lists: one for each key byte, and
+ * the last for bits of v.  A guess takes the list of the positions it
+ * wakes, for the next node to advance, and only those.  A position that is
+ * done is in no list.
+ */
+struct hxb_wait {
+	uint32_t *head;			/* first of each list, or none */
+	uint32_t ready;			/* first of the positions woken */
+	uint32_t live;			/* positions not done */
+};
+
+/*
+ * The values a key byte not yet guessed may have, for the positions waiting
+ * on it at their last jump, before a step.  The step must make its known
+ * keystream byte, and only one value of the key byte does, so each position
+ * allows one value.  The domain of a byte is every value if no position
+ * waits so on it, the value of the first if every other agrees, or else
+ * empty, and the node fails.
+ */
+struct hxb_dom {
+	uint32_t *count;		/* positions allowing one value */
+	uint32_t *diff;			/* of those, not the value of the first */
+	uint8_t *val;			/* value of the first */
 };
 
 struct hxb_ord {
@@ -41,38 +404,138 @@ struct hxb_ctx {
 	size_t sz_key;			/* size of key */
 	size_t sz_hx;			/* size of state */
 	size_t pos_count;		/* number of positions */
-	struct hxb_pos **pos;		/* cipher positions */
+	struct hxb_text *text;		/* corpus of the positions */
+	struct hxb_pos pos;		/* running state of the positions */
+	struct hxb_over over;		/* key bytes written by the positions */
 	struct hx_state *hx_orig;	/* guessed original state */
-	struct hx_state *hx_mask;	/* mask of guessed bits */
+	struct hxb_mask mask;		/* guessed bits, and positions waiting */
+	struct hxb_wait wait;		/* positions waiting, by guess */
+	struct hxb_dom dom;		/* values of the key bytes not guessed */
 	struct hxb_ord *ord;		/* fixed guessing order */
 };
 
 /* --- --- --- --- --- --- --- --- --- */
 
+static inline int hxb_mask_have(struct hxb_mask *mask, uint32_t m)
+{
+	return mask->key[m >> 6] >> (m & 63) & 1;
+}
+
+/* positions waiting at a key byte, or none if it is guessed */
+static uint32_t hxb_mask_wait(struct hxb_mask *mask, uint32_t m)
+{
+	return hxb_mask_have(mask, m) ? 0 : mask->count[m];
+}
+
+/* a node of the tree, of its children */
+static void hxb_mask_node(struct hxb_mask *mask, size_t k)
+{
+	uint32_t a = mask->tree[2 * k];
+	uint32_t b = mask->tree[2 * k + 1];
+
+	mask->tree[k] = hxb_mask_wait(mask, b) > hxb_mask_wait(mask, a) ? b : a;
+}
+
+/* fix the nodes of the tree over a key byte, from its leaf to the root */
+static void hxb_mask_fix(struct hxb_mask *mask, size_t sz_key, uint32_t m)
+{
+	size_t k;
+
+	for (k = (sz_key + m) >> 1; k; k >>= 1)
+		hxb_mask_node(mask, k);
+}
+
+/* mark a byte, to fix the tree over it later */
+static inline void hxb_mask_dirty(struct hxb_mask *mask, uint32_t m)
+{
+	uint64_t bit = (uint64_t)1 << (m & 63);
+
+	if (mask->dirty[m >> 6] & bit)
+		return;
+
+	mask->dirty[m >> 6] |= bit;
+	mask->dirty_m[mask->dirty_count++] = m;
+}
+
+static void hxb_mask_set(struct hxb_mask *mask, uint32_t m, int have)
+{
+	if (have)
+		mask->key[m >> 6] |= (uint64_t)1 << (m & 63);
+	else
+		mask->key[m >> 6] &= ~((uint64_t)1 << (m & 63));
+
+	hxb_mask_dirty(mask, m);
+}
+
+/* a position moved from one key byte to another */
+static inline void hxb_mask_move(struct hxb_mask *mask, uint32_t from,
+				 uint32_t to)
+{
+	--mask->count[from];
+	hxb_mask_dirty(mask, from);
+
+	++mask->count[to];
+	hxb_mask_dirty(mask, to);
+}
+
+/* the key byte not guessed with the most positions, the first if equal */
+static uint32_t hxb_mask_most(struct hxb_mask *mask, size_t sz_key)
+{
+	uint32_t m;
+
+	while (mask->dirty_count) {
+		m = mask->dirty_m[--mask->dirty_count];
+		mask->dirty[m >> 6] &= ~((uint64_t)1 << (m & 63));
+
+		hxb_mask_fix(mask, sz_key, m);
+	}
+
+	return mask->tree[1];
+}
+
+/* build the tree, of the counts of the positions */
+static void hxb_mask_build(struct hxb_mask *mask, size_t sz_key)
+{
+	size_t k;
+
+	for (k = 0; k < sz_key; ++k)
+		mask->tree[sz_key + k] = k;
+
+	for (k = sz_key - 1; k; --k)
+		hxb_mask_node(mask, k);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
 static void hxb_ctx_show(struct hxb_ctx *ctx, FILE *f, char *where)
 {
 	size_t data_len = (ctx->sz_key * 4 / 3 + 3) & ~3;
 	char *data = malloc(data_len + 1);
+	uint8_t *have = malloc(ctx->sz_key);
 	size_t pos_i;
-	struct hxb_pos *pos;
+	uint32_t m;
 
 	fprintf(f, "--(%s)------------------------------------------\n", where);
-	fprintf(f, "v: %#x (%#x)\n", ctx->hx_orig->v, ctx->hx_mask->v);
+	fprintf(f, "v: %#x (%#x)\n", ctx->hx_orig->v, ctx->mask.v);
 
 	b64_encode(ctx->hx_orig->key, ctx->sz_key, data, data_len + 1);
 	fprintf(f, "k: %s\n", data);
 
-	b64_encode(ctx->hx_mask->key, ctx->sz_key, data, data_len + 1);
+	/* a byte of the mask for each key byte */
+	for (m = 0; m < ctx->sz_key; ++m)
+		have[m] = hxb_mask_have(&ctx->mask, m) ? 0xff : 0;
+
+	b64_encode(have, ctx->sz_key, data, data_len + 1);
 	fprintf(f, "m: %s\n", data);
 
 	if (hohha_dbg_level) {
-		for (pos_i = 0; pos_i < ctx->pos_count; ++pos_i) {
-			pos = ctx->pos[pos_i];
-			fprintf(f, "pos[%zu]: jmp %zu idx %zu len %zu\n",
-				pos_i, pos->jmp, pos->idx, pos->len);
-		}
+		for (pos_i = 0; pos_i < ctx->pos_count; ++pos_i)
+			fprintf(f, "pos[%zu]: jmp %u idx %u len %u\n",
+				pos_i, ctx->pos.jmp[pos_i], ctx->pos.idx[pos_i],
+				ctx->text->len[pos_i]);
 	}
 
+	free(have);
 	free(data);
 }
 
@@ -99,25 +562,44 @@ static void hxb_ord_prev(struct hxb_ord *ord)
 	--ord->next;
 }
 
+static struct hxb_ord *hxb_ord_dup(struct hxb_ord *ord, size_t sz_key)
+{
+	struct hxb_ord *dup;
+	size_t sz = sizeof(*ord) + sizeof(*ord->m) * sz_key;
+
+	dup = malloc(sz);
+	memcpy(dup, ord, sz);
+
+	return dup;
+}
+
 /* --- --- --- --- --- --- --- --- --- */
 
 #define HXB_MAX_FREE (1u << 14)
 
-struct hx_state *hxb_hx_free_list[HXB_MAX_FREE];
-size_t hxb_hx_free_count;
+/* free lists of one thread */
+struct hxb_free {
+	struct hx_state *hx_list[HXB_MAX_FREE];
+	size_t hx_count;
+};
 
-struct hxb_pos *hxb_pos_free_list[HXB_MAX_FREE];
-size_t hxb_pos_free_count;
+static __thread struct hxb_free *hxb_fl;	/* free lists of this thread */
 
-struct hxb_ctx *hxb_ctx_free_list[HXB_MAX_FREE];
-size_t hxb_ctx_free_count;
+static void hxb_free_new(void)
+{
+	hxb_fl = calloc(1, sizeof(*hxb_fl));
+	if (!hxb_fl) {
+		pr("out of memory\n");
+		exit(1);
+	}
+}
 
 /* --- --- --- --- --- --- --- --- --- */
 
 static void hxb_hx_free(struct hx_state *hx)
 {
-	if (hxb_hx_free_count < HXB_MAX_FREE) {
-		hxb_hx_free_list[hxb_hx_free_count++] = hx;
+	if (hxb_fl->hx_count < HXB_MAX_FREE) {
+		hxb_fl->hx_list[hxb_fl->hx_count++] = hx;
 		return;
 	}
 
@@ -126,30 +608,45 @@ static void hxb_hx_free(struct hx_state *hx)
 
 static void hxb_pos_free(struct hxb_pos *pos)
 {
-	if (hxb_pos_free_count < HXB_MAX_FREE) {
-		hxb_pos_free_list[hxb_pos_free_count++] = pos;
-		return;
-	}
+	/* the arrays are in the block of the first */
+	free(pos->s1);
+}
 
-	hxb_hx_free(pos->hx);
-	free(pos);
+static void hxb_over_free(struct hxb_over *over)
+{
+	free(over->ent);
 }
 
-static void hxb_ctx_free(struct hxb_ctx *ctx)
+static void hxb_mask_free(struct hxb_mask *mask)
 {
-	size_t i;
+	/* the arrays are in the block of the first */
+	free(mask->key);
+}
 
-	if (hxb_ctx_free_count < HXB_MAX_FREE) {
-		hxb_ctx_free_list[hxb_ctx_free_count++] = ctx;
-		return;
-	}
+static void hxb_wait_free(struct hxb_wait *wait)
+{
+	free(wait->head);
+}
 
-	for (i = 0; i < ctx->pos_count; ++i)
-		hxb_pos_free(ctx->pos[i]);
+static void hxb_dom_free(struct hxb_dom *dom)
+{
+	/* the arrays are in the block of the first */
+	free(dom->count);
+}
 
-	hxb_hx_free(ctx->hx_orig);
-	hxb_hx_free(ctx->hx_mask);
-	free(ctx->pos);
+/*
+ * Free a context of a task, not to the free lists.  It was allocated by the
+ * thread that split the task, so freeing it to the lists of the thread that
+ * stole it would only grow those lists.
+ */
+static void hxb_ctx_release(struct hxb_ctx *ctx)
+{
+	hxb_pos_free(&ctx->pos);
+	hxb_over_free(&ctx->over);
+	hxb_mask_free(&ctx->mask);
+	hxb_wait_free(&ctx->wait);
+	hxb_dom_free(&ctx->dom);
+	free(ctx->hx_orig);
 	free(ctx);
 }
 
@@ -159,130 +656,202 @@ static struct hx_state *hxb_hx_alloc(size_t sz_hx)
 {
 	struct hx_state *dup;
 
-	if (hxb_hx_free_count)
-		return hxb_hx_free_list[--hxb_hx_free_count];
+	if (hxb_fl->hx_count)
+		return hxb_fl->hx_list[--hxb_fl->hx_count];
 
 	dup = malloc(sz_hx);
 
 	return dup;
 }
 
-static struct hxb_pos *hxb_pos_alloc(size_t sz_hx)
+/* size of the block of running state of the positions */
+static size_t hxb_pos_size(size_t pos_count)
 {
-	struct hxb_pos *dup;
-
-	if (hxb_pos_free_count)
-		return hxb_pos_free_list[--hxb_pos_free_count];
+	return pos_count * 8 * sizeof(uint32_t);
+}
 
-	dup = malloc(sizeof(*dup));
-	dup->hx = hxb_hx_alloc(sz_hx);
+static void hxb_pos_alloc(struct hxb_pos *pos, size_t pos_count)
+{
+	pos->s1 = malloc(hxb_pos_size(pos_count) ?: 1);
+	if (!pos->s1) {
+		pr("out of memory\n");
+		exit(1);
+	}
 
-	return dup;
+	pos->s2 = pos->s1 + pos_count;
+	pos->m = pos->s2 + pos_count;
+	pos->v = pos->m + pos_count;
+	pos->cs = pos->v + pos_count;
+	pos->idx = pos->cs + pos_count;
+	pos->jmp = pos->idx + pos_count;
+	pos->next = pos->jmp + pos_count;
 }
 
-static struct hxb_ctx *hxb_ctx_alloc(size_t pos_count, size_t sz_hx)
+/* size of the table of key bytes written */
+static size_t hxb_over_size(uint32_t mask)
 {
-	struct hxb_ctx *dup;
-	size_t i;
-
-	if (hxb_ctx_free_count)
-		return hxb_ctx_free_list[--hxb_ctx_free_count];
+	return ((size_t)mask + 1) * sizeof(struct hxb_over_ent);
+}
 
-	dup = malloc(sizeof(*dup));
-	dup->pos = malloc(sizeof(*dup->pos) * pos_count);
-	dup->hx_orig = hxb_hx_alloc(sz_hx);
-	dup->hx_mask = hxb_hx_alloc(sz_hx);
+static void hxb_over_alloc(struct hxb_over *over, uint32_t mask)
+{
+	over->ent = calloc((size_t)mask + 1, sizeof(*over->ent));
+	if (!over->ent) {
+		pr("out of memory\n");
+		exit(1);
+	}
 
-	for (i = 0; i < pos_count; ++i)
-		dup->pos[i] = hxb_pos_alloc(sz_hx);
+	over->mask = mask;
+	over->count = 0;
+}
 
-	return dup;
+/* words of the bits of the key bytes guessed */
+static size_t hxb_mask_words(size_t sz_key)
+{
+	return (sz_key + 63) / 64;
 }
 
-/* --- --- --- --- --- --- --- --- --- */
+/* size of the block of the mask, the marks, the counts and the tree */
+static size_t hxb_mask_size(size_t sz_key)
+{
+	return 2 * hxb_mask_words(sz_key) * sizeof(uint64_t) +
+		4 * sz_key * sizeof(uint32_t);
+}
 
-static void hxb_hx_cpy(struct hx_state *dup, struct hx_state *hx, size_t sz_hx)
+static void hxb_mask_alloc(struct hxb_mask *mask, size_t sz_key)
 {
-	memcpy(dup, hx, sz_hx);
+	mask->key = calloc(1, hxb_mask_size(sz_key));
+	if (!mask->key) {
+		pr("out of memory\n");
+		exit(1);
+	}
+
+	mask->v = 0;
+	mask->dirty = mask->key + hxb_mask_words(sz_key);
+	mask->dirty_m = (uint32_t *)(mask->dirty + hxb_mask_words(sz_key));
+	mask->dirty_count = 0;
+	mask->count = mask->dirty_m + sz_key;
+	mask->tree = mask->count + sz_key;
 }
 
-static void hxb_pos_cpy(struct hxb_pos *dup, struct hxb_pos *pos, size_t sz_hx)
+/* size of the heads of the wait lists */
+static size_t hxb_wait_size(size_t sz_key)
 {
-	dup->s1 = pos->s1;
-	dup->s2 = pos->s2;
-	hxb_hx_cpy(dup->hx, pos->hx, sz_hx);
-	dup->mesg = pos->mesg;
-	dup->ciph = pos->ciph;
-	dup->len = pos->len;
-	dup->idx = pos->idx;
-	dup->jmp = pos->jmp;
+	return (sz_key + 1) * sizeof(uint32_t);
 }
 
-static void hxb_ctx_cpy(struct hxb_ctx *dup, struct hxb_ctx *ctx)
+static void hxb_wait_alloc(struct hxb_wait *wait, size_t sz_key)
 {
-	size_t i;
+	size_t k;
 
-	hxb_hx_cpy(dup->hx_orig, ctx->hx_orig, ctx->sz_hx);
-	hxb_hx_cpy(dup->hx_mask, ctx->hx_mask, ctx->sz_hx);
-	dup->pos_count = ctx->pos_count;
-	dup->sz_key = ctx->sz_key;
-	dup->sz_hx = ctx->sz_hx;
-	dup->ord = ctx->ord;
+	wait->head = malloc(hxb_wait_size(sz_key));
+	if (!wait->head) {
+		pr("out of memory\n");
+		exit(1);
+	}
 
-	for (i = 0; i < ctx->pos_count; ++i)
-		hxb_pos_cpy(dup->pos[i], ctx->pos[i], ctx->sz_hx);
+	for (k = 0; k <= sz_key; ++k)
+		wait->head[k] = HXB_WAIT_NONE;
+
+	wait->ready = HXB_WAIT_NONE;
+	wait->live = 0;
 }
 
-/* --- --- --- --- --- --- --- --- --- */
+/* size of the block of the domains */
+static size_t hxb_dom_size(size_t sz_key)
+{
+	return sz_key * (2 * sizeof(uint32_t) + 1);
+}
 
-static struct hx_state *hxb_hx_dup(struct hx_state *hx, size_t sz_hx)
+static void hxb_dom_alloc(struct hxb_dom *dom, size_t sz_key)
 {
-	struct hx_state *dup;
+	dom->count = calloc(1, hxb_dom_size(sz_key));
+	if (!dom->count) {
+		pr("out of memory\n");
+		exit(1);
+	}
+
+	dom->diff = dom->count + sz_key;
+	dom->val = (uint8_t *)(dom->diff + sz_key);
+}
+
+static struct hxb_ctx *hxb_ctx_alloc(size_t pos_count, uint32_t over_mask,
+				     size_t sz_key, size_t sz_hx)
+{
+	struct hxb_ctx *dup;
 
-	dup = hxb_hx_alloc(sz_hx);
-	hxb_hx_cpy(dup, hx, sz_hx);
+	dup = malloc(sizeof(*dup));
+	hxb_pos_alloc(&dup->pos, pos_count);
+	hxb_over_alloc(&dup->over, over_mask);
+	hxb_mask_alloc(&dup->mask, sz_key);
+	hxb_wait_alloc(&dup->wait, sz_key);
+	hxb_dom_alloc(&dup->dom, sz_key);
+	dup->hx_orig = hxb_hx_alloc(sz_hx);
 
 	return dup;
 }
 
-static struct hxb_pos *hxb_pos_dup(struct hxb_pos *pos, size_t sz_hx)
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxb_hx_cpy(struct hx_state *dup, struct hx_state *hx, size_t sz_hx)
+{
+	memcpy(dup, hx, sz_hx);
+}
+
+static void hxb_ctx_cpy(struct hxb_ctx *dup, struct hxb_ctx *ctx)
 {
-	struct hxb_pos *dup;
+	hxb_hx_cpy(dup->hx_orig, ctx->hx_orig, ctx->sz_hx);
+	dup->mask.v = ctx->mask.v;
+	dup->mask.dirty_count = ctx->mask.dirty_count;
+	memcpy(dup->mask.key, ctx->mask.key, hxb_mask_size(ctx->sz_key));
 
-	dup = hxb_pos_alloc(sz_hx);
-	hxb_pos_cpy(dup, pos, sz_hx);
+	memcpy(dup->wait.head, ctx->wait.head, hxb_wait_size(ctx->sz_key));
+	dup->wait.ready = ctx->wait.ready;
+	dup->wait.live = ctx->wait.live;
 
-	return dup;
+	memcpy(dup->dom.count, ctx->dom.count, hxb_dom_size(ctx->sz_key));
+	dup->pos_count = ctx->pos_count;
+	dup->sz_key = ctx->sz_key;
+	dup->sz_hx = ctx->sz_hx;
+	dup->text = ctx->text;
+	dup->ord = ctx->ord;
+
+	memcpy(dup->pos.s1, ctx->pos.s1, hxb_pos_size(ctx->pos_count));
+
+	memcpy(dup->over.ent, ctx->over.ent, hxb_over_size(ctx->over.mask));
+	dup->over.count = ctx->over.count;
 }
 
+/* --- --- --- --- --- --- --- --- --- */
+
 static struct hxb_ctx *hxb_ctx_dup(struct hxb_ctx *ctx)
 {
 	struct hxb_ctx *dup;
 
-	dup = hxb_ctx_alloc(ctx->pos_count, ctx->sz_hx);
+	dup = hxb_ctx_alloc(ctx->pos_count, ctx->over.mask, ctx->sz_key,
+			    ctx->sz_hx);
 	hxb_ctx_cpy(dup, ctx);
 
+	hxb_bstat->dup_bytes += ctx->sz_hx + hxb_mask_size(ctx->sz_key) +
+		hxb_wait_size(ctx->sz_key) + hxb_dom_size(ctx->sz_key) +
+		hxb_pos_size(ctx->pos_count) + hxb_over_size(ctx->over.mask);
+
 	return dup;
 }
 
 /* --- --- --- --- --- --- --- --- --- */
 
-static int hxb_hx_check(struct hx_state *hx, uint8_t *mesg, uint8_t *ciph, size_t len)
+static int hxb_hx_check(struct hx_state *hx, struct hxb_byte *text, size_t len)
 {
 	size_t i;
-	uint8_t mesg_x;
-	uint8_t ciph_x;
 
 	for (i = 0; i < len; ++i) {
 		hx->jump_fn(hx);
 
-		mesg_x = mesg[i];
-		ciph_x = ciph[i];
-
-		if (hx_step_xor(hx) != (mesg_x ^ ciph_x))
+		if (hx_step_xor(hx) != text[i].x)
 			return -1;
 
-		hx_step_crc(hx, mesg_x);
+		hx_step_crc(hx, text[i].mesg);
 	}
 
 	return 0;
@@ -291,364 +860,1501 @@ static int hxb_hx_check(struct hx_state *hx, uint8_t *mesg, uint8_t *ciph, size_
 static int hxb_ctx_check(struct hxb_ctx *ctx)
 {
 	struct hx_state *hx;
-	struct hxb_pos *pos;
+	struct hxb_text *text = ctx->text;
 	size_t i;
 	int rc = 0;
 
 	hx = hxb_hx_alloc(ctx->sz_hx);
 
-	for (i = 0; i < ctx->pos_count; ++i) {
-		pos = ctx->pos[i];
+	for (i = 0; i < ctx->pos_count; ++i) {
+		memcpy(hx, ctx->hx_orig, ctx->sz_hx);
+		hx->s1 = text->s1[i];
+		hx->s2 = text->s2[i];
+		hx->m = (text->s1[i] >> 24) * (text->s2[i] >> 24);
+		hx->m &= hx->key_mask;
+
+		rc = hxb_hx_check(hx, text->text[i], ctx->pos.idx[i]);
+		if (rc)
+			break;
+	}
+
+	hxb_hx_free(hx);
+
+	return rc;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxb_over_home(struct hxb_over *over, uint32_t slot)
+{
+	uint32_t hash = slot * 0x9e3779b1u;
+
+	return (hash ^ hash >> 16) & over->mask;
+}
+
+/* the entry of a slot, or the free entry where it would be */
+static inline struct hxb_over_ent *hxb_over_find(struct hxb_over *over,
+						 uint32_t slot)
+{
+	uint32_t k = hxb_over_home(over, slot);
+
+	while (over->ent[k].slot && over->ent[k].slot != slot)
+		k = (k + 1) & over->mask;
+
+	return &over->ent[k];
+}
+
+/* double the table, if one more entry would fill more than half */
+static void hxb_over_fit(struct hxb_over *over)
+{
+	struct hxb_over old = *over;
+	uint32_t k;
+
+	if (over->count < over->mask / 2)
+		return;
+
+	hxb_over_alloc(over, old.mask * 2 + 1);
+
+	for (k = 0; k <= old.mask; ++k)
+		if (old.ent[k].slot)
+			*hxb_over_find(over, old.ent[k].slot) = old.ent[k];
+
+	over->count = old.count;
+
+	hxb_over_free(&old);
+}
+
+/*
+ * Free an entry.  The entries after it, to the next free entry, are moved
+ * back if their probe passed it, so that each can still be found.
+ */
+static void hxb_over_del(struct hxb_over *over, struct hxb_over_ent *ent)
+{
+	uint32_t j = ent - over->ent, k = j, home;
+
+	for (;;) {
+		k = (k + 1) & over->mask;
+		if (!over->ent[k].slot)
+			break;
+
+		home = hxb_over_home(over, over->ent[k].slot);
+		if (((k - home) & over->mask) < ((k - j) & over->mask))
+			continue;
+
+		over->ent[j] = over->ent[k];
+		j = k;
+	}
+
+	over->ent[j].slot = 0;
+	--over->count;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxb_hx_guess_key(struct hx_state *hx, uint32_t m, uint8_t x)
+{
+	hx->key[m] = x;
+}
+
+static void hxb_ctx_guess_key(struct hxb_ctx *ctx, uint32_t m, uint32_t x)
+{
+	x ^= ctx->hx_orig->key[m];
+
+	hxb_hx_guess_key(ctx->hx_orig, m, x);
+}
+
+static void hxb_ctx_mask_key(struct hxb_ctx *ctx, uint32_t m)
+{
+	hxb_mask_set(&ctx->mask, m, 1);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxb_hx_guess_v(struct hx_state *hx, uint32_t v)
+{
+	hx->v ^= v;
+}
+
+static void hxb_pos_guess_v(struct hxb_ctx *ctx, uint32_t v)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	size_t i;
+
+	for (i = 0; i < ctx->pos_count; ++i)
+		pos->v[i] ^= rol32(v, pos->idx[i] & 31);
+}
+
+static void hxb_ctx_guess_v(struct hxb_ctx *ctx, uint32_t v)
+{
+	hxb_hx_guess_v(ctx->hx_orig, v);
+	hxb_pos_guess_v(ctx, v);
+}
+
+static void hxb_ctx_mask_v(struct hxb_ctx *ctx, uint32_t v)
+{
+	ctx->mask.v |= v;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/*
+ * The search changes one context in place, and records how to undo each
+ * change on a trail, so that backtracking restores only what changed.
+ */
+enum hxb_undo_type {
+	HXB_UNDO_KEY,			/* a key byte was guessed */
+	HXB_UNDO_V,			/* bits of v were guessed */
+	HXB_UNDO_POS,			/* a position was advanced */
+	HXB_UNDO_JUMP,			/* a jump wrote a key byte */
+	HXB_UNDO_WAKE,			/* a guess took a wait list */
+	HXB_UNDO_WAIT,			/* a position was put on a wait list */
+	HXB_UNDO_DONE,			/* a position was done */
+	HXB_UNDO_DOM,			/* a position allowed one value */
+};
+
+struct hxb_undo {
+	uint8_t type;			/* enum hxb_undo_type */
+	uint8_t x;			/* key byte before, or value allowed */
+	uint8_t had;			/* the position had written it */
+	uint32_t i;			/* index of the position, or first woken */
+	uint32_t m;			/* key index, m of the position, or list */
+	uint32_t v;			/* v guessed, v of the position, or next */
+	uint32_t mask;			/* bits of v guessed */
+	uint32_t s1, s2, cs;		/* state of the position */
+	uint32_t idx, jmp;		/* step and jump of the position */
+};
+
+static __thread struct hxb_undo *hxb_trail;	/* trail of this thread */
+static __thread size_t hxb_trail_count;
+static __thread size_t hxb_trail_cap;
+
+static struct hxb_undo *hxb_undo_push(uint8_t type)
+{
+	struct hxb_undo *undo;
+
+	if (hxb_trail_count == hxb_trail_cap) {
+		hxb_trail_cap = hxb_trail_cap ? hxb_trail_cap * 2 : 4096;
+		hxb_trail = realloc(hxb_trail,
+				    sizeof(*hxb_trail) * hxb_trail_cap);
+		if (!hxb_trail) {
+			pr("out of memory\n");
+			exit(1);
+		}
+	}
+
+	undo = &hxb_trail[hxb_trail_count++];
+	undo->type = type;
+
+	hxb_bstat->undo_bytes += sizeof(*undo);
+
+	return undo;
+}
+
+/* the state of a position, before it is advanced in a node */
+static void hxb_undo_pos(struct hxb_pos *pos, size_t i)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_POS);
+
+	undo->i = i;
+	undo->s1 = pos->s1[i];
+	undo->s2 = pos->s2[i];
+	undo->m = pos->m[i];
+	undo->v = pos->v[i];
+	undo->cs = pos->cs[i];
+	undo->idx = pos->idx[i];
+	undo->jmp = pos->jmp[i];
+}
+
+/* the key byte of a position, before a jump writes it */
+static void hxb_undo_jump(size_t i, uint32_t m, uint8_t x, uint8_t had)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_JUMP);
+
+	undo->i = i;
+	undo->m = m;
+	undo->x = x;
+	undo->had = had;
+}
+
+/* wake the positions on a list, for the next node to advance */
+static void hxb_wait_wake(struct hxb_ctx *ctx, uint32_t list)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_WAKE);
+
+	undo->i = ctx->wait.head[list];
+	undo->m = list;
+
+	ctx->wait.ready = ctx->wait.head[list];
+	ctx->wait.head[list] = HXB_WAIT_NONE;
+}
+
+/* put a position on a list, to wait for a guess */
+static void hxb_wait_put(struct hxb_ctx *ctx, uint32_t i, uint32_t list)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_WAIT);
+
+	undo->i = i;
+	undo->m = list;
+	undo->v = ctx->pos.next[i];
+
+	ctx->pos.next[i] = ctx->wait.head[list];
+	ctx->wait.head[list] = i;
+}
+
+/* a position is done, and waits for nothing */
+static void hxb_wait_done(struct hxb_ctx *ctx)
+{
+	hxb_undo_push(HXB_UNDO_DONE);
+
+	--ctx->wait.live;
+}
+
+/*
+ * A position allows one value of a key byte.  Returns nonzero if the domain
+ * of the byte is empty.
+ */
+static int hxb_dom_allow(struct hxb_ctx *ctx, uint32_t m, uint8_t x)
+{
+	struct hxb_dom *dom = &ctx->dom;
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_DOM);
+
+	undo->m = m;
+	undo->x = x;
+
+	/* undone in reverse, the first is the last undone */
+	if (!dom->count[m]++)
+		dom->val[m] = x;
+	else if (dom->val[m] != x)
+		++dom->diff[m];
+
+	return !!dom->diff[m];
+}
+
+/*
+ * Guess a key byte, not yet known.  No position has jumped over an unknown
+ * key byte, so none has written it, and each one reads the guess from the
+ * original state.
+ */
+static void hxb_ctx_try_key(struct hxb_ctx *ctx, uint32_t m, uint32_t x)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_KEY);
+
+	undo->m = m;
+	undo->x = ctx->hx_orig->key[m];
+
+	hxb_ctx_mask_key(ctx, m);
+	hxb_ctx_guess_key(ctx, m, x);
+
+	hxb_wait_wake(ctx, m);
+}
+
+/* guess bits of v, not yet known */
+static void hxb_ctx_try_v(struct hxb_ctx *ctx, uint32_t mask, uint32_t v)
+{
+	struct hxb_undo *undo = hxb_undo_push(HXB_UNDO_V);
+
+	undo->v = v;
+	undo->mask = mask;
+
+	hxb_ctx_mask_v(ctx, mask);
+	hxb_ctx_guess_v(ctx, v);
+
+	/* some may wait for other bits, and are put back on the list */
+	hxb_wait_wake(ctx, ctx->sz_key);
+}
+
+/* undo the changes on the trail, back to a mark */
+static void hxb_ctx_undo(struct hxb_ctx *ctx, size_t mark)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	struct hxb_over_ent *ent;
+	struct hxb_undo *undo;
+	size_t i;
+
+	while (hxb_trail_count > mark) {
+		undo = &hxb_trail[--hxb_trail_count];
+		i = undo->i;
+
+		switch (undo->type) {
+		case HXB_UNDO_KEY:
+			hxb_hx_guess_key(ctx->hx_orig, undo->m, undo->x);
+			hxb_mask_set(&ctx->mask, undo->m, 0);
+			break;
+
+		case HXB_UNDO_V:
+			/* the guess is an xor, at the steps of the guess */
+			ctx->mask.v &= ~undo->mask;
+			hxb_ctx_guess_v(ctx, undo->v);
+			break;
+
+		case HXB_UNDO_POS:
+			if (pos->m[i] != undo->m)
+				hxb_mask_move(&ctx->mask, pos->m[i], undo->m);
+			pos->s1[i] = undo->s1;
+			pos->s2[i] = undo->s2;
+			pos->m[i] = undo->m;
+			pos->v[i] = undo->v;
+			pos->cs[i] = undo->cs;
+			pos->idx[i] = undo->idx;
+			pos->jmp[i] = undo->jmp;
+			break;
+
+		case HXB_UNDO_JUMP:
+			ent = hxb_over_find(&ctx->over,
+					    i * ctx->sz_key + undo->m + 1);
+			if (undo->had)
+				ent->x = undo->x;
+			else
+				hxb_over_del(&ctx->over, ent);
+			break;
+
+		case HXB_UNDO_WAKE:
+			ctx->wait.head[undo->m] = i;
+			ctx->wait.ready = HXB_WAIT_NONE;
+			break;
+
+		case HXB_UNDO_WAIT:
+			ctx->wait.head[undo->m] = pos->next[i];
+			pos->next[i] = undo->v;
+			break;
+
+		case HXB_UNDO_DONE:
+			++ctx->wait.live;
+			break;
+
+		case HXB_UNDO_DOM:
+			if (--ctx->dom.count[undo->m] &&
+			    ctx->dom.val[undo->m] != undo->x)
+				--ctx->dom.diff[undo->m];
+			break;
+		}
+	}
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static int hxb_pos_done(struct hxb_ctx *ctx, size_t i)
+{
+	return ctx->pos.idx[i] == ctx->text->len[i];
+}
+
+static int hxb_ctx_done(struct hxb_ctx *ctx)
+{
+	return !ctx->wait.live;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxb_need_v(struct hxb_mask *mask, uint32_t key_mask,
+			   uint32_t idx)
+{
+	return ~mask->v & ror32(key_mask | 0xff, idx & 31);
+}
+
+static uint32_t hxb_pos_need_v(struct hxb_ctx *ctx, size_t i)
+{
+	return hxb_need_v(&ctx->mask, ctx->hx_orig->key_mask,
+			  ctx->pos.idx[i]);
+}
+
+/*
+ * The value of the key byte at the last jump of a position, for which the
+ * step after it makes its keystream byte: the jump xors the byte into s1 or
+ * s2, and rotates the other.
+ */
+static uint8_t hxb_pos_allow(struct hxb_ctx *ctx, uint32_t i)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	uint32_t x = ctx->text->text[i][pos->idx[i]].x ^ pos->v[i];
+
+	if (!(pos->jmp[i] & 1))
+		return u8(x ^ pos->s1[i] ^ rol32(pos->s2[i], 1));
+	else
+		return u8(x ^ ror32(pos->s1[i], 1) ^ pos->s2[i]);
+}
+
+/*
+ * Put a position that has advanced on the list of the guess it waits for:
+ * bits of v at its step, or else the key byte at its jump.  Returns nonzero
+ * if no value of the key byte is left.
+ */
+static int hxb_pos_block(struct hxb_ctx *ctx, uint32_t i)
+{
+	uint32_t m = ctx->pos.m[i];
+
+	if (hxb_pos_done(ctx, i)) {
+		hxb_wait_done(ctx);
+		return 0;
+	}
+
+	if (hxb_pos_need_v(ctx, i)) {
+		hxb_wait_put(ctx, i, ctx->sz_key);
+		return 0;
+	}
+
+	hxb_wait_put(ctx, i, m);
+
+	if (ctx->pos.jmp[i] + 1 == ctx->hx_orig->key_jumps)
+		return hxb_dom_allow(ctx, m, hxb_pos_allow(ctx, i));
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/*
+ * One jump, the same as hx_jump_n, on the state of a position, from the key
+ * byte x at m.  Returns the byte that the jump writes over it.
+ */
+static inline uint8_t hxb_jump(uint32_t jmp, uint8_t x, uint32_t key_mask,
+			       uint32_t *s1, uint32_t *s2, uint32_t *m,
+			       uint32_t v)
+{
+	uint8_t w;
+
+	if (!(jmp & 1)) {
+		*s1 ^= x;
+		w = u8(*s2);
+		*m ^= jmp ? v : *s2;
+		*m &= key_mask;
+		*s2 = rol32(*s2, 1);
+	} else {
+		*s2 ^= x;
+		w = u8(*s1);
+		*m ^= jmp == 1 ? v : *s1;
+		*m &= key_mask;
+		*s1 = ror32(*s1, 1);
+	}
+
+	return w;
+}
+
+/* a position is done, or its next step needs a guess */
+static int hxb_pos_wait(struct hxb_ctx *ctx, size_t i)
+{
+	struct hxb_mask *mask = &ctx->mask;
+	uint32_t idx = ctx->pos.idx[i];
+	uint32_t m = ctx->pos.m[i];
+
+	return idx == ctx->text->len[i] ||
+		hxb_need_v(mask, ctx->hx_orig->key_mask, idx) ||
+		(ctx->pos.jmp[i] < ctx->hx_orig->key_jumps &&
+		 !hxb_mask_have(mask, m));
+}
+
+/*
+ * Advance a position as far as the known key bytes and bits of v permit.
+ * The state is advanced in locals, and stored once at the end.
+ */
+static int hxb_pos_adv(struct hxb_ctx *ctx, size_t i)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	struct hxb_over *over = &ctx->over;
+	struct hxb_over_ent *ent;
+	struct hxb_mask *mask = &ctx->mask;
+	struct hxb_byte *text;
+	uint8_t *key = ctx->hx_orig->key;
+	uint8_t x;
+	uint32_t slot;
+	uint32_t len = ctx->text->len[i];
+	uint32_t key_jumps = ctx->hx_orig->key_jumps;
+	uint32_t key_mask = ctx->hx_orig->key_mask;
+	uint32_t s1, s2, cs, v;
+	uint32_t m, idx, jmp;
+	int rc = 0, saved = 0;
+
+	/* most positions wait for a guess: check before loading the rest */
+	if (hxb_pos_wait(ctx, i))
+		return 0;
+
+	text = ctx->text->text[i];
+	slot = i * ctx->sz_key + 1;
+	m = pos->m[i];
+	idx = pos->idx[i];
+	jmp = pos->jmp[i];
+	s1 = pos->s1[i];
+	s2 = pos->s2[i];
+	v = pos->v[i];
+	cs = pos->cs[i];
+
+	while (idx != len) {
+		if (hxb_need_v(mask, key_mask, idx))
+			goto out;
+
+		while (jmp < key_jumps) {
+			if (!hxb_mask_have(mask, m))
+				goto out;
+
+			if (!saved) {
+				hxb_undo_pos(pos, i);
+				saved = 1;
+			}
+
+			/* the byte this position wrote, or the original */
+			hxb_over_fit(over);
+			ent = hxb_over_find(over, slot + m);
+			if (ent->slot) {
+				x = ent->x;
+				hxb_undo_jump(i, m, x, 1);
+			} else {
+				x = key[m];
+				hxb_undo_jump(i, m, 0, 0);
+				ent->slot = slot + m;
+				++over->count;
+			}
+
+			ent->x = hxb_jump(jmp, x, key_mask, &s1, &s2, &m, v);
+
+			++jmp;
+		}
+
+		if (!saved) {
+			hxb_undo_pos(pos, i);
+			saved = 1;
+		}
+
+		if (u8(v ^ s1 ^ s2) != text[idx].x) {
+			rc = -1;
+			goto out;
+		}
+
+		cs = crc32_byte(cs, text[idx].mesg);
+		v = rol32(v ^ cs, 1);
+
+		jmp = 0;
+		++idx;
+	}
+
+out:
+	/*
+	 * A failed position is undone before its state is read again, but
+	 * for the bytes stepped: so it is not moved to another key byte, only
+	 * to be moved back.
+	 */
+	if (rc) {
+		pos->idx[i] = idx;
+		return rc;
+	}
+
+	if (saved) {
+		if (pos->m[i] != m)
+			hxb_mask_move(mask, pos->m[i], m);
+		pos->s1[i] = s1;
+		pos->s2[i] = s2;
+		pos->m[i] = m;
+		pos->v[i] = v;
+		pos->cs[i] = cs;
+		pos->idx[i] = idx;
+		pos->jmp[i] = jmp;
+	}
+
+	return rc;
+}
+
+/*
+ * Advance the positions woken by the last guess, to the first that fails,
+ * and put each on the list of the guess it waits for next.
+ */
+static int hxb_ctx_adv(struct hxb_ctx *ctx)
+{
+	uint64_t pos_adv = 0, bytes = 0;
+	uint32_t i, next, idx;
+	int rc = 0;
+
+	i = ctx->wait.ready;
+	ctx->wait.ready = HXB_WAIT_NONE;
+
+	for (; i != HXB_WAIT_NONE; i = next) {
+		next = ctx->pos.next[i];
+		idx = ctx->pos.idx[i];
+
+		rc = hxb_pos_adv(ctx, i);
+
+		/* a failed step is stepped, too */
+		if (ctx->pos.idx[i] != idx || rc) {
+			++pos_adv;
+			bytes += ctx->pos.idx[i] - idx + !!rc;
+		}
+
+		if (rc)
+			break;
+
+		rc = hxb_pos_block(ctx, i);
+		if (rc)
+			break;
+	}
+
+	hxb_bstat->pos_adv += pos_adv;
+	hxb_bstat->bytes += bytes;
+
+	return rc;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* jumps left in a step, at most, to find the values a position allows */
+#define HXB_REST_JUMPS 8
+
+/* the values of a key byte, a bit for each guess */
+#define HXB_ALLOW_WORDS (0x100 / 64)
+
+/*
+ * The jumps left in the step of a position, waiting at a key byte, and the
+ * byte each one reads: the first reads the guess, and each other a byte
+ * known, or the byte that a jump before it in the step wrote.
+ */
+struct hxb_rest {
+	uint32_t i;			/* position */
+	uint32_t count;			/* jumps left */
+	int8_t from[HXB_REST_JUMPS];	/* jump that wrote the byte, or -1 */
+	uint8_t key[HXB_REST_JUMPS];	/* byte known */
+};
+
+/*
+ * Find the bytes the jumps left in a step read, with the current byte at
+ * the guess.  Returns nonzero if a byte is not known, or if the key bytes
+ * the jumps move to depend on the guess: at odd jumps after the second, m
+ * moves by s1, which has the guess after an even jump xors it in.
+ */
+static int hxb_rest_read(struct hxb_ctx *ctx, uint32_t i,
+			 struct hxb_rest *rest)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	struct hxb_over_ent *ent;
+	uint8_t *key = ctx->hx_orig->key;
+	uint32_t key_mask = ctx->hx_orig->key_mask;
+	uint32_t slot = i * ctx->sz_key + 1;
+	uint32_t wm[HXB_REST_JUMPS];
+	uint8_t wg[HXB_REST_JUMPS];
+	uint32_t s1, s2, m, k, j, jmp;
+	int g1 = 0, g2 = 0, g;		/* s1, s2 or a byte have the guess */
+	uint8_t x;
+
+	rest->i = i;
+	rest->count = ctx->hx_orig->key_jumps - pos->jmp[i];
+	if (rest->count > HXB_REST_JUMPS)
+		return -1;
+
+	s1 = pos->s1[i];
+	s2 = pos->s2[i];
+	m = pos->m[i];
+	jmp = pos->jmp[i];
+
+	for (k = 0; k < rest->count; ++k, ++jmp) {
+		rest->from[k] = -1;
+
+		/* the latest byte written by the step, or one known */
+		for (j = k; j-- && wm[j] != m; )
+			;
+
+		if (!k) {
+			x = key[m];
+			g = 1;
+		} else if (j != UINT32_MAX) {
+			rest->from[k] = j;
+			x = 0;
+			g = wg[j];
+		} else {
+			ent = hxb_over_find(&ctx->over, slot + m);
+			if (ent->slot)
+				x = ent->x;
+			else if (hxb_mask_have(&ctx->mask, m))
+				x = key[m];
+			else
+				return -1;
+			g = 0;
+		}
+
+		rest->key[k] = x;
+		wm[k] = m;
+
+		if (!(jmp & 1)) {
+			g1 |= g;
+			wg[k] = g2;
+			if (!jmp && g2)
+				return -1;
+		} else {
+			g2 |= g;
+			wg[k] = g1;
+			if (jmp != 1 && g1)
+				return -1;
+		}
+
+		hxb_jump(jmp, x, key_mask, &s1, &s2, &m, pos->v[i]);
+	}
+
+	return 0;
+}
+
+/* the byte of the step after the jumps left, xor its keystream byte */
+static uint8_t hxb_rest_eval(struct hxb_ctx *ctx, struct hxb_rest *rest,
+			     uint8_t guess)
+{
+	struct hxb_pos *pos = &ctx->pos;
+	uint32_t i = rest->i;
+	uint32_t s1 = pos->s1[i];
+	uint32_t s2 = pos->s2[i];
+	uint32_t jmp = pos->jmp[i];
+	uint32_t m = 0, k;
+	uint8_t w[HXB_REST_JUMPS];
+	uint8_t x;
+
+	for (k = 0; k < rest->count; ++k, ++jmp) {
+		if (!k)
+			x = guess;
+		else if (rest->from[k] >= 0)
+			x = w[rest->from[k]];
+		else
+			x = rest->key[k];
+
+		/* m is not needed: the bytes read are already found */
+		w[k] = hxb_jump(jmp, x, 0, &s1, &s2, &m, 0);
+	}
+
+	return u8(pos->v[i] ^ s1 ^ s2) ^ ctx->text->text[i][pos->idx[i]].x;
+}
+
+/*
+ * Remove the values of the key byte a position waits at, for which the step
+ * after the jumps left does not make its keystream byte.  The jumps xor the
+ * guess into s1 and s2, rotate them, and copy bytes of them, so the byte of
+ * the step is the byte of the current value, xor a byte for each bit of the
+ * guess: nine runs of the jumps give the bytes of all 256 guesses, in a
+ * table of xors.
+ */
+static void hxb_pos_allow_all(struct hxb_ctx *ctx, uint32_t i,
+			      uint64_t *allow)
+{
+	struct hxb_rest rest;
+	uint8_t out[0x100];
+	uint8_t x0, col;
+	uint32_t b, n;
+	uint64_t word;
+
+	if (hxb_rest_read(ctx, i, &rest))
+		return;
+
+	x0 = ctx->hx_orig->key[ctx->pos.m[i]];
+
+	/* out[n] is zero, if the guess n makes the keystream byte */
+	out[0] = hxb_rest_eval(ctx, &rest, x0);
+	for (b = 0; b < 8; ++b) {
+		col = hxb_rest_eval(ctx, &rest, x0 ^ (1u << b)) ^ out[0];
+		for (n = 0; n < (1u << b); ++n)
+			out[n | 1u << b] = out[n] ^ col;
+	}
+
+	for (b = 0; b < HXB_ALLOW_WORDS; ++b) {
+		word = 0;
+		for (n = 0; n < 64; ++n)
+			word |= (uint64_t)!out[b * 64 + n] << n;
+		allow[b] &= word;
+	}
+}
+
+/*
+ * The guesses of a key byte that every position waiting at it allows.  The
+ * positions at their last jump allow the value of the domain, if any.
+ */
+static void hxb_ctx_allow(struct hxb_ctx *ctx, uint32_t m, uint64_t *allow)
+{
+	uint32_t key_jumps = ctx->hx_orig->key_jumps;
+	uint32_t i, n;
+	int last = 0;
 
-		memcpy(hx, ctx->hx_orig, ctx->sz_hx);
-		hx->s1 = pos->s1;
-		hx->s2 = pos->s2;
-		hx->m = (pos->s1 >> 24) * (pos->s2 >> 24);
-		hx->m &= pos->hx->key_mask;
+	memset(allow, 0xff, sizeof(*allow) * HXB_ALLOW_WORDS);
 
-		rc = hxb_hx_check(hx, pos->mesg, pos->ciph, pos->idx);
-		if (rc)
-			break;
+	if (ctx->dom.count[m]) {
+		n = ctx->dom.val[m] ^ ctx->hx_orig->key[m];
+		memset(allow, 0, sizeof(*allow) * HXB_ALLOW_WORDS);
+		allow[n >> 6] = (uint64_t)1 << (n & 63);
+		last = 1;
 	}
 
-	hxb_hx_free(hx);
+	for (i = ctx->wait.head[m]; i != HXB_WAIT_NONE; i = ctx->pos.next[i]) {
+		if (last && ctx->pos.jmp[i] + 1 == key_jumps)
+			continue;
 
-	return rc;
+		hxb_pos_allow_all(ctx, i, allow);
+
+		if (!(allow[0] | allow[1] | allow[2] | allow[3]))
+			return;
+	}
 }
 
 /* --- --- --- --- --- --- --- --- --- */
 
-static void hxb_hx_guess_key(struct hx_state *hx, uint32_t m, uint8_t x)
-{
-	hx->key[m] = x;
-}
+/* split subtrees for other threads, no deeper than this */
+#define HXB_SPLIT_DEPTH 16
+
+/* guess bits of v, instead of a key byte */
+#define HXB_BRANCH_V UINT32_MAX
+
+/*
+ * Children of a node, or a range of them: each guesses the bits of a mask,
+ * in v, or in a key byte.  Guesses are numbered in order, and the bits of
+ * the number are spread to the bits of the mask.
+ */
+struct hxb_branch {
+	struct hxb_ctx *ctx;		/* the node */
+	uint32_t depth;			/* depth of the node */
+	uint32_t m;			/* key byte, or HXB_BRANCH_V */
+	uint32_t mask;			/* bits guessed */
+	uint64_t next;			/* number of the next guess */
+	uint64_t end;			/* number after the last guess */
+	uint64_t allow[HXB_ALLOW_WORDS]; /* guesses of a key byte to try */
+};
 
-static void hxb_pos_guess_key(struct hxb_pos *pos, uint32_t m, uint8_t x)
-{
-	hxb_hx_guess_key(pos->hx, m, x);
-}
+/* a range of children, split from a node, with its own copy of the node */
+struct hxb_task {
+	struct hxb_branch br;
+};
 
-static void hxb_ctx_guess_key(struct hxb_ctx *ctx, uint32_t m, uint32_t x)
-{
-	size_t i;
+/*
+ * Tasks of one thread.  The owner pushes and pops the newest at the tail,
+ * and other threads steal the oldest, nearest the root, at the head.
+ */
+struct hxb_deque {
+	pthread_mutex_t lock;
+	struct hxb_task *task;
+	size_t head;
+	size_t tail;
+	size_t cap;
+};
 
-	x ^= ctx->hx_orig->key[m];
+struct hxb_thr {
+	pthread_t thr;
+	uint32_t idx;			/* index of the thread */
+	struct hxb_deque dq;		/* tasks of the thread */
+	uint64_t seed;			/* choice of a victim */
+};
 
-	hxb_hx_guess_key(ctx->hx_orig, m, x);
+static uint32_t hxb_threads = 1;
+static struct hxb_thr *hxb_thr;
+static __thread struct hxb_thr *hxb_self;
 
-	for (i = 0; i < ctx->pos_count; ++i)
-		hxb_pos_guess_key(ctx->pos[i], m, x);
-}
+static uint64_t hxb_queued;		/* tasks in the deques */
+static uint64_t hxb_pending;		/* tasks queued or running */
+static uint32_t hxb_idle;		/* threads waiting for a task */
+static pthread_mutex_t hxb_sched_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t hxb_sched_cond = PTHREAD_COND_INITIALIZER;
 
-static void hxb_ctx_mask_key(struct hxb_ctx *ctx, uint32_t m)
+/* split children at this depth, if more threads wait than tasks */
+static int hxb_split(uint32_t depth)
 {
-	hxb_hx_guess_key(ctx->hx_mask, m, ~0);
+	return hxb_threads > 1 && depth < HXB_SPLIT_DEPTH &&
+		__atomic_load_n(&hxb_idle, __ATOMIC_RELAXED) >
+		__atomic_load_n(&hxb_queued, __ATOMIC_RELAXED);
 }
 
-/* --- --- --- --- --- --- --- --- --- */
-
-static void hxb_hx_guess_v(struct hx_state *hx, uint32_t v)
+/* split the later half of the children of a node to a task */
+static void hxb_task_push(struct hxb_branch *br)
 {
-	hx->v ^= v;
+	struct hxb_deque *dq = &hxb_self->dq;
+	struct hxb_task task;
+	uint64_t mid = br->next + (br->end - br->next) / 2;
+
+	task.br = *br;
+	task.br.next = mid;
+	br->end = mid;
+
+	/* the subtrees continue the guessing order on their own */
+	task.br.ctx = hxb_ctx_dup(br->ctx);
+	task.br.ctx->ord = hxb_ord_dup(br->ctx->ord, br->ctx->sz_key);
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail == dq->cap) {
+		dq->cap = dq->cap ? dq->cap * 2 : 64;
+		dq->task = realloc(dq->task, sizeof(*dq->task) * dq->cap);
+	}
+	dq->task[dq->tail++] = task;
+	pthread_mutex_unlock(&dq->lock);
+
+	__atomic_fetch_add(&hxb_pending, 1, __ATOMIC_SEQ_CST);
+	__atomic_fetch_add(&hxb_queued, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&hxb_idle, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&hxb_sched_lock);
+		pthread_cond_signal(&hxb_sched_cond);
+		pthread_mutex_unlock(&hxb_sched_lock);
+	}
 }
 
-static void hxb_pos_guess_v(struct hxb_pos *pos, uint32_t v)
+/* take a task from one deque, the newest, or the oldest to steal it */
+static int hxb_task_take(struct hxb_deque *dq, struct hxb_task *task,
+			 int steal)
 {
-	hxb_hx_guess_v(pos->hx, rol32(v, pos->idx & 31));
+	int rc = -1;
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->head != dq->tail) {
+		if (steal)
+			*task = dq->task[dq->head++];
+		else
+			*task = dq->task[--dq->tail];
+
+		if (dq->head == dq->tail)
+			dq->head = dq->tail = 0;
+
+		rc = 0;
+	}
+	pthread_mutex_unlock(&dq->lock);
+
+	if (!rc)
+		__atomic_fetch_sub(&hxb_queued, 1, __ATOMIC_SEQ_CST);
+
+	return rc;
 }
 
-static void hxb_ctx_guess_v(struct hxb_ctx *ctx, uint32_t v)
+static int hxb_task_steal(struct hxb_task *task)
 {
-	size_t i;
+	uint32_t i, victim;
 
-	hxb_hx_guess_v(ctx->hx_orig, v);
+	victim = splitmix64(&hxb_self->seed) % hxb_threads;
 
-	for (i = 0; i < ctx->pos_count; ++i)
-		hxb_pos_guess_v(ctx->pos[i], v);
+	for (i = 0; i < hxb_threads; ++i) {
+		if (victim != hxb_self->idx &&
+		    !hxb_task_take(&hxb_thr[victim].dq, task, 1))
+			return 0;
+
+		if (++victim == hxb_threads)
+			victim = 0;
+	}
+
+	return -1;
 }
 
-static void hxb_ctx_mask_v(struct hxb_ctx *ctx, uint32_t v)
+/* get a task, or wait for one, or nonzero at the end of the search */
+static int hxb_task_get(struct hxb_task *task)
 {
-	ctx->hx_mask->v |= v;
-}
+	int end;
 
-/* --- --- --- --- --- --- --- --- --- */
+	for (;;) {
+		if (hxb_stopped())
+			return -1;
 
-static int hxb_pos_done(struct hxb_pos *pos)
-{
-	return pos->idx == pos->len;
+		if (!hxb_task_take(&hxb_self->dq, task, 0) ||
+		    !hxb_task_steal(task))
+			return 0;
+
+		pthread_mutex_lock(&hxb_sched_lock);
+		__atomic_fetch_add(&hxb_idle, 1, __ATOMIC_SEQ_CST);
+		while (!__atomic_load_n(&hxb_queued, __ATOMIC_SEQ_CST) &&
+		       __atomic_load_n(&hxb_pending, __ATOMIC_SEQ_CST) &&
+		       !hxb_stopped())
+			pthread_cond_wait(&hxb_sched_cond, &hxb_sched_lock);
+		__atomic_fetch_sub(&hxb_idle, 1, __ATOMIC_SEQ_CST);
+		end = !__atomic_load_n(&hxb_pending, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&hxb_sched_lock);
+
+		if (end)
+			return -1;
+	}
 }
 
-static int hxb_ctx_done(struct hxb_ctx *ctx)
+/* a task is done: wake the waiting threads at the end of the search */
+static void hxb_task_done(void)
 {
-	size_t i;
+	if (__atomic_sub_fetch(&hxb_pending, 1, __ATOMIC_SEQ_CST) &&
+	    !hxb_stopped())
+		return;
 
-	for (i = 0; i < ctx->pos_count; ++i)
-		if (!hxb_pos_done(ctx->pos[i]))
-			return 0;
-	return 1;
+	pthread_mutex_lock(&hxb_sched_lock);
+	pthread_cond_broadcast(&hxb_sched_cond);
+	pthread_mutex_unlock(&hxb_sched_lock);
 }
 
 /* --- --- --- --- --- --- --- --- --- */
 
-static int hxb_pos_have_m(struct hxb_pos *pos, struct hx_state *mask)
+static void hxb_ctx_brut(struct hxb_ctx *ctx);
+
+static int hxb_bmi2;			/* spread guesses with pdep and pext */
+
+#ifdef __x86_64__
+__attribute__((target("bmi2")))
+static uint32_t hxb_mask_word_bmi2(uint64_t num, uint32_t mask)
 {
-	return !!mask->key[pos->hx->m];
+	return _pdep_u32((uint32_t)num, mask);
 }
 
-static uint32_t hxb_pos_need_m(struct hxb_pos *pos)
+__attribute__((target("bmi2")))
+static uint64_t hxb_mask_num_bmi2(uint32_t word, uint32_t mask)
 {
-	return pos->hx->m;
+	return _pext_u32(word, mask);
 }
+#endif
 
-static uint32_t hxb_pos_need_v(struct hxb_pos *pos, struct hx_state *mask)
+/* the guess of a number, its bits spread to the bits of a mask */
+static uint32_t hxb_mask_word(uint64_t num, uint32_t mask)
 {
-	return ~mask->v & ror32(pos->hx->key_mask | 0xff, pos->idx & 31);
-}
+	uint32_t word = 0;
 
-/* --- --- --- --- --- --- --- --- --- */
+#ifdef __x86_64__
+	if (hxb_bmi2)
+		return hxb_mask_word_bmi2(num, mask);
+#endif
 
-static void hxb_pos_jump(struct hxb_pos *pos)
-{
-	hx_jump_n(pos->hx, pos->jmp);
+	for (; mask; mask &= mask - 1, num >>= 1)
+		if (num & 1)
+			word |= mask & -mask;
+
+	return word;
 }
 
-static int hxb_pos_step(struct hxb_pos *pos)
+/* the number of a guess, its bits gathered from the bits of a mask */
+static uint64_t hxb_mask_num(uint32_t word, uint32_t mask)
 {
-	size_t i = pos->idx;
-	uint8_t mesg_x = pos->mesg[i];
-	uint8_t ciph_x = pos->ciph[i];
+	uint64_t num = 0;
+	uint32_t bit;
 
-	if (hx_step_xor(pos->hx) != (mesg_x ^ ciph_x))
-		return -1;
+#ifdef __x86_64__
+	if (hxb_bmi2)
+		return hxb_mask_num_bmi2(word, mask);
+#endif
 
-	hx_step_crc(pos->hx, mesg_x);
+	for (bit = 0; mask; mask &= mask - 1, ++bit)
+		if (word & mask & -mask)
+			num |= (uint64_t)1 << bit;
 
-	return 0;
+	return num;
 }
 
-static int hxb_pos_adv(struct hxb_pos *pos, struct hx_state *mask)
+static void hxb_branch_run(struct hxb_branch *br, struct hxbs_depth *sd)
 {
-	int rc;
+	uint32_t guess;
+	size_t mark;
 
-	while (!hxb_pos_done(pos)) {
-		if (hxb_pos_need_v(pos, mask))
-			return 0;
+	while (br->next < br->end && !hxb_stopped()) {
+		if (br->end - br->next > 1 && hxb_split(br->depth + 1))
+			hxb_task_push(br);
 
-		while (pos->jmp < pos->hx->key_jumps) {
-			if (!hxb_pos_have_m(pos, mask))
-				return 0;
+		guess = hxb_mask_word(br->next++, br->mask);
 
-			hxb_pos_jump(pos);
+		if (br->m != HXB_BRANCH_V &&
+		    !(br->allow[guess >> 6] >> (guess & 63) & 1))
+			continue;
 
-			++pos->jmp;
+		mark = hxb_trail_count;
+		if (br->m == HXB_BRANCH_V) {
+			hxb_ctx_try_v(br->ctx, br->mask, guess);
+			++sd->v_branches;
+		} else {
+			hxb_ctx_try_key(br->ctx, br->m, guess);
+			++sd->m_branches;
 		}
 
-		rc = hxb_pos_step(pos);
-		if (rc)
-			return rc;
+		hxb_ctx_brut(br->ctx);
 
-		pos->jmp = 0;
-		++pos->idx;
+		hxb_ctx_undo(br->ctx, mark);
 	}
-
-	return 0;
 }
 
-static int hxb_ctx_adv(struct hxb_ctx *ctx)
+/*
+ * Solve for the bits of v a position needs in the low byte of its step.
+ * The jumps are run from a copy of the state, and the low byte of v must
+ * make the keystream byte with s1 and s2 after them.  The jumps read at m
+ * moved by v only after the second, so with two jumps, no bit of v is
+ * needed to read the key bytes.
+ *
+ * Sets the bits solved, in the frame of the original v, and their guess, as
+ * an xor of the bits before.  None are solved if a key byte is not known.
+ * Returns nonzero if the bits already guessed do not make the byte.
+ */
+static int hxb_pos_solve_v(struct hxb_ctx *ctx, uint32_t i, uint32_t *bits,
+			   uint32_t *guess)
 {
-	size_t i;
-	int rc;
+	struct hxb_pos *pos = &ctx->pos;
+	struct hxb_over_ent *ent;
+	uint8_t *key = ctx->hx_orig->key;
+	uint32_t key_jumps = ctx->hx_orig->key_jumps;
+	uint32_t key_mask = ctx->hx_orig->key_mask;
+	uint32_t slot = i * ctx->sz_key + 1;
+	uint32_t s1 = pos->s1[i];
+	uint32_t s2 = pos->s2[i];
+	uint32_t m = pos->m[i];
+	uint32_t idx = pos->idx[i];
+	uint32_t jmp = pos->jmp[i];
+	uint32_t wm[HXB_REST_JUMPS];
+	uint8_t wx[HXB_REST_JUMPS];
+	uint32_t need, low, k, j;
+	uint8_t x, d;
+
+	*bits = 0;
+	*guess = 0;
+
+	if (key_jumps - jmp > HXB_REST_JUMPS)
+		return 0;
 
-	for (i = 0; i < ctx->pos_count; ++i) {
-		rc = hxb_pos_adv(ctx->pos[i], ctx->hx_mask);
-		if (rc)
-			return rc;
+	/* a jump after the second reads at m moved by v */
+	need = hxb_pos_need_v(ctx, i);
+	if (key_jumps > 2 && jmp + 1 < key_jumps &&
+	    (need & ror32(key_mask, idx & 31)))
+		return 0;
+
+	for (k = 0; jmp < key_jumps; ++k, ++jmp) {
+		/* the latest byte written by the jumps, or one known */
+		for (j = k; j-- && wm[j] != m; )
+			;
+
+		if (j != UINT32_MAX) {
+			x = wx[j];
+		} else {
+			ent = hxb_over_find(&ctx->over, slot + m);
+			if (ent->slot)
+				x = ent->x;
+			else if (hxb_mask_have(&ctx->mask, m))
+				x = key[m];
+			else
+				return 0;
+		}
+
+		wm[k] = m;
+		wx[k] = hxb_jump(jmp, x, key_mask, &s1, &s2, &m, pos->v[i]);
 	}
 
-	return 0;
-}
+	/* the bits of the low byte not guessed, in the frame of the step */
+	low = rol32(need, idx & 31) & 0xff;
+	d = u8(pos->v[i] ^ s1 ^ s2) ^ ctx->text->text[i][idx].x;
 
-/* --- --- --- --- --- --- --- --- --- */
+	if (d & ~low)
+		return -1;
 
-static void hxb_ctx_brut(struct hxb_ctx *ctx);
+	*bits = ror32(low, idx & 31);
+	*guess = ror32(d, idx & 31);
 
-static int hxb_ctx_brut_v(struct hxb_ctx *ctx)
+	return 0;
+}
+
+/*
+ * Guess bits of v for the positions waiting for them.  The bits that the
+ * steps of positions solve for are guessed in one child, if every step
+ * agrees on the bits they share, each at its own rotation of v, or else in
+ * none.  Bits no step solves for are guessed after, each value a child.
+ */
+static int hxb_ctx_brut_v(struct hxb_ctx *ctx, struct hxbs_depth *sd)
 {
-	struct hxb_ctx *dup;
-	size_t i;
-	uint32_t need;
-	uint32_t guess;
+	struct hxb_branch br;
+	uint32_t i, need, bits, guess;
+	uint32_t solved = 0, value = 0;
 
 	need = 0;
-	for (i = 0; i < ctx->pos_count; ++i)
-		need |= hxb_pos_need_v(ctx->pos[i], ctx->hx_mask);
+	for (i = ctx->wait.head[ctx->sz_key]; i != HXB_WAIT_NONE;
+	     i = ctx->pos.next[i]) {
+		if (hxb_pos_solve_v(ctx, i, &bits, &guess))
+			return 1;
 
-	if (!need)
-		return 0;
+		if ((value ^ guess) & solved & bits)
+			return 1;
 
-	for (guess = 0; guess <= need; guess = incr32_mask(guess, need)) {
-		dup = hxb_ctx_dup(ctx);
-		hxb_ctx_mask_v(dup, need);
-		hxb_ctx_guess_v(dup, guess);
+		solved |= bits;
+		value |= guess;
+		need |= hxb_pos_need_v(ctx, i);
+	}
 
-		hxb_ctx_brut(dup);
+	if (!need)
+		return 0;
 
-		hxb_ctx_free(dup);
+	br.ctx = ctx;
+	br.depth = hxb_depth - 1;
+	br.m = HXB_BRANCH_V;
+	br.mask = need;
+	br.next = 0;
+	br.end = (uint64_t)1 << __builtin_popcount(need);
+
+	/* one child, with the bits solved */
+	if (solved) {
+		br.mask = solved;
+		br.next = hxb_mask_num(value, solved);
+		br.end = br.next + 1;
 	}
 
+	hxb_branch_run(&br, sd);
+
 	return 1;
 }
 
 static void hxb_ctx_ord_fix(struct hxb_ctx *ctx)
 {
-	size_t i, sz;
-	size_t *need_val;
+	hxb_ord_fix(ctx->ord, hxb_mask_most(&ctx->mask, ctx->sz_key));
+}
 
-	sz = ctx->sz_key;
+static int hxb_ctx_brut_m(struct hxb_ctx *ctx, struct hxbs_depth *sd)
+{
+	struct hxb_branch br;
+	uint32_t i;
 
-	need_val = malloc(sizeof(*need_val) * sz);
-	memset(need_val, 0, sizeof(*need_val) * sz);
+	hxb_ctx_ord_fix(ctx);
 
-	for (i = 0; i < ctx->pos_count; ++i) {
-		if (hxb_pos_have_m(ctx->pos[i], ctx->hx_mask))
+	br.ctx = ctx;
+	br.depth = hxb_depth - 1;
+	br.m = hxb_ord_next(ctx->ord);
+	br.mask = 0xff;
+	br.next = 0;
+	br.end = 0;
+
+	/* guess only the values every position allows, from the first */
+	hxb_ctx_allow(ctx, br.m, br.allow);
+	for (i = 0; i < HXB_ALLOW_WORDS; ++i) {
+		if (!br.allow[i])
 			continue;
-
-		++need_val[hxb_pos_need_m(ctx->pos[i])];
+		if (!br.end)
+			br.next = i * 64 + __builtin_ctzll(br.allow[i]);
+		br.end = i * 64 + 64 - __builtin_clzll(br.allow[i]);
 	}
 
-	hxb_ord_fix(ctx->ord, max_idx(need_val, sz));
+	hxb_branch_run(&br, sd);
+
+	hxb_ord_prev(ctx->ord);
 
-	free(need_val);
+	return 1;
 }
 
-static int hxb_ctx_brut_m(struct hxb_ctx *ctx)
+static void hxb_ctx_node(struct hxb_ctx *ctx, struct hxbs_depth *sd)
 {
-	struct hxb_ctx *dup;
-	uint32_t m, guess;
+	double secs;
+	int rc, seen, done;
 
-	hxb_ctx_ord_fix(ctx);
+	if (hxb_stopped())
+		return;
 
-	m = hxb_ord_next(ctx->ord);
+	if (!hxb_nodes_left && hxb_nodes_take()) {
+		hxb_stop_set("nodes");
+		return;
+	}
 
-	for (guess = 0; guess <= 0xff; ++guess) {
-		dup = hxb_ctx_dup(ctx);
-		hxb_ctx_mask_key(dup, m);
-		hxb_ctx_guess_key(dup, m, guess);
+	--hxb_nodes_left;
+	++hxb_bstat->nodes;
+	++sd->nodes;
 
-		hxb_ctx_brut(dup);
+	if ((hxb_max_secs || hxb_bstat_shm) &&
+	    !(hxb_bstat->nodes % HXB_TIME_EVERY)) {
+		secs = hxb_secs();
 
-		hxb_ctx_free(dup);
-	}
+		if (hxb_max_secs && secs >= hxb_max_secs) {
+			hxb_stop_set("time");
+			return;
+		}
 
-	hxb_ord_prev(ctx->ord);
+		if (hxb_bstat_shm)
+			hxb_bstat_publish(secs, 0);
+	}
 
-	return 1;
-}
+	if (hxb_perf && !(hxb_bstat->nodes % HXB_PERF_EVERY)) {
+		hxp_begin(hxb_perf, &hxb_perf_adv);
+		rc = hxb_ctx_adv(ctx);
+		hxp_end(hxb_perf, &hxb_perf_adv);
+	} else {
+		rc = hxb_ctx_adv(ctx);
+	}
 
-static void hxb_ctx_brut(struct hxb_ctx *ctx)
-{
-	if (hxb_ctx_adv(ctx))
+	if (rc) {
+		++sd->backtracks;
 		return;
+	}
 
 	if (hxb_dbg_level && hxb_ctx_check(ctx)) {
 		hxb_ctx_show(ctx, stderr, "fail");
 		exit(2);
 	}
 
-	if (done_sigusr1 != seen_sigusr1) {
-		done_sigusr1 = seen_sigusr1;
+	/* the first thread to see the signal shows its progress */
+	seen = seen_sigusr1;
+	done = done_sigusr1;
+	if (done != seen &&
+	    __atomic_compare_exchange_n(&done_sigusr1, &done, seen, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&hxb_out_lock);
 		hxb_ctx_show(ctx, stderr, "info");
+
+		if (hxb_perf) {
+			/* count the search so far, and continue */
+			hxp_end(hxb_perf, &hxb_perf_search);
+			hxp_begin(hxb_perf, &hxb_perf_search);
+			hxb_perf_show(stderr, hxb_bstat->nodes);
+		}
+
+		if (hxb_bstat_json)
+			hxb_bstat_show(hxb_bstat_json);
+		pthread_mutex_unlock(&hxb_out_lock);
 	}
 
 	if (hxb_ctx_done(ctx)) {
+		pthread_mutex_lock(&hxb_out_lock);
 		hxb_ctx_show(ctx, stdout, "done");
+		fflush(stdout);
+
+		if (!hxb_solutions++)
+			hxb_first_secs = hxb_secs();
+		++hxb_bstat->solutions;
+		pthread_mutex_unlock(&hxb_out_lock);
+
+		if (hxb_quit_first)
+			hxb_stop_set("solved");
 		return;
 	}
 
-	if (hxb_ctx_brut_v(ctx))
+	if (hxb_ctx_brut_v(ctx, sd))
 		return;
 
-	if (hxb_ctx_brut_m(ctx))
+	if (hxb_ctx_brut_m(ctx, sd))
 		return;
 
 	pr("Unreachable %s:%d\n", __FILE__, __LINE__);
 }
 
+/* count a node at its depth, and its time with the nodes below it */
+static void hxb_ctx_brut(struct hxb_ctx *ctx)
+{
+	struct hxbs_depth *sd;
+	uint64_t ns = 0;
+
+	/* deeper nodes are counted, and timed once, in the last depth */
+	if (hxb_depth < HXBS_DEPTH) {
+		sd = &hxb_bstat->depth[hxb_depth];
+		if (hxb_bstat_time)
+			ns = hxb_ns();
+	} else {
+		sd = &hxb_bstat->depth[HXBS_DEPTH - 1];
+	}
+
+	if (hxb_bstat->depth_max < hxb_depth)
+		hxb_bstat->depth_max = hxb_depth;
+
+	++hxb_depth;
+	hxb_ctx_node(ctx, sd);
+	--hxb_depth;
+
+	if (ns)
+		sd->ns += hxb_ns() - ns;
+}
+
 /* --- --- --- --- --- --- --- --- --- */
 
-static void hxb_ctx_read(struct hxb_ctx *ctx, FILE *f)
+/* search the tasks of this thread, and steal more, to the end */
+static void hxb_work(void)
 {
-	struct hxb_pos *pos;
-	size_t pos_i;
-	uint8_t raw_S[8];
-	char *arg_m;
-	char *arg_x;
-	size_t raw_m_len;
-	size_t raw_x_len;
-	int rc;
+	struct hxb_task task;
 
-	for (;;) {
-		arg_m = NULL;
-		arg_x = NULL;
+	struct hxbs_depth *sd;
+
+	while (!hxb_task_get(&task)) {
+		/* the children are one deeper than their node */
+		if (task.br.depth < HXBS_DEPTH)
+			sd = &hxb_bstat->depth[task.br.depth];
+		else
+			sd = &hxb_bstat->depth[HXBS_DEPTH - 1];
+
+		hxb_depth = task.br.depth + 1;
+		hxb_branch_run(&task.br, sd);
+
+		free(task.br.ctx->ord);
+		hxb_ctx_release(task.br.ctx);
+
+		hxb_task_done();
+	}
+
+	hxb_nodes_give();
+}
 
-		rc = fscanf(f, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu %ms %ms",
-			    &raw_S[0], &raw_S[1], &raw_S[2], &raw_S[3],
-			    &raw_S[4], &raw_S[5], &raw_S[6], &raw_S[7],
-			    &arg_m, &arg_x);
+static void *hxb_thr_run(void *arg)
+{
+	hxb_self = arg;
+	hxb_free_new();
+	hxb_bstat_new();
 
-		if (rc != 10)
-			goto err;
+	hxb_work();
 
-		if (b64_decode(arg_m, strlen(arg_m), NULL, &raw_m_len))
-			goto err;
+	return NULL;
+}
 
-		if (b64_decode(arg_x, strlen(arg_x), NULL, &raw_x_len))
-			goto err;
+/* --- --- --- --- --- --- --- --- --- */
 
-		if (raw_m_len != raw_x_len)
-			goto err;
+static void hxb_ctx_read(struct hxb_ctx *ctx, FILE *f)
+{
+	struct hxk_kpa kpa;
+	struct hxk_pair *pair;
+	struct hxb_text *text;
+	struct hxb_pos *pos;
+	struct hxb_byte *arena;
+	size_t pos_i, i, total = 0;
 
-		pos_i = ctx->pos_count;
+	if (hxk_read(&kpa, f))
+		pr("warning: invalid or truncated binary corpus\n");
 
-		if (!pos_i) {
-			ctx->pos = malloc(sizeof(*ctx->pos));
-		} else if (is_pow2(pos_i)) {
-			ctx->pos = realloc(ctx->pos, sizeof(*ctx->pos)
-					   * (pos_i << 1));
+	for (pos_i = 0; pos_i < kpa.count; ++pos_i) {
+		if (kpa.pair[pos_i].len > UINT32_MAX) {
+			pr("message too long\n");
+			exit(1);
 		}
+		total += kpa.pair[pos_i].len;
+	}
+
+	text = malloc(sizeof(*text));
+	text->s1 = malloc(sizeof(*text->s1) * (kpa.count ?: 1));
+	text->s2 = malloc(sizeof(*text->s2) * (kpa.count ?: 1));
+	text->len = malloc(sizeof(*text->len) * (kpa.count ?: 1));
+	text->text = malloc(sizeof(*text->text) * (kpa.count ?: 1));
+	text->arena = malloc(sizeof(*text->arena) * (total ?: 1));
+
+	ctx->text = text;
+	ctx->pos_count = kpa.count;
+
+	/* the table of key bytes written is indexed by position and byte */
+	if (kpa.count && ctx->sz_key > (UINT32_MAX - 1) / kpa.count) {
+		pr("too many messages for the key length\n");
+		exit(1);
+	}
+
+	pos = &ctx->pos;
+	hxb_pos_alloc(pos, kpa.count);
+	hxb_over_alloc(&ctx->over, HXB_OVER_MIN - 1);
+	hxb_mask_alloc(&ctx->mask, ctx->sz_key);
+	hxb_wait_alloc(&ctx->wait, ctx->sz_key);
+	hxb_dom_alloc(&ctx->dom, ctx->sz_key);
 
-		pos = malloc(sizeof(*pos));
-		pos->s1 = leu32(raw_S + 0);
-		pos->s2 = leu32(raw_S + 4);
-		pos->hx = hxb_hx_dup(ctx->hx_orig, ctx->sz_hx);
-		pos->hx->s1 = pos->s1;
-		pos->hx->s2 = pos->s2;
-		pos->hx->m = (pos->s1 >> 24) * (pos->s2 >> 24);
-		pos->hx->m &= pos->hx->key_mask;
-		pos->mesg = malloc(raw_m_len);
-		pos->ciph = malloc(raw_x_len);
-		pos->len = raw_x_len;
-		pos->idx = 0;
-		pos->jmp = 0;
+	arena = text->arena;
 
-		b64_decode(arg_m, strlen(arg_m), pos->mesg, &raw_m_len);
-		b64_decode(arg_x, strlen(arg_x), pos->ciph, &raw_x_len);
+	for (pos_i = 0; pos_i < kpa.count; ++pos_i) {
+		pair = &kpa.pair[pos_i];
 
-		ctx->pos[pos_i] = pos;
-		ctx->pos_count = pos_i + 1;
+		text->s1[pos_i] = hxk_pair_s1(pair);
+		text->s2[pos_i] = hxk_pair_s2(pair);
+		text->len[pos_i] = pair->len;
+		text->text[pos_i] = arena;
 
-		dbg("pos[%zu] s1 %#x s2 %#x mesg %s ciph %s\n",
-		    pos_i, pos->hx->s1, pos->hx->s2, arg_m, arg_x);
+		/* the keystream each step must make, next to its plaintext */
+		for (i = 0; i < pair->len; ++i) {
+			arena[i].mesg = pair->mesg[i];
+			arena[i].x = pair->mesg[i] ^ pair->ciph[i];
+		}
+		arena += pair->len;
+
+		pos->s1[pos_i] = text->s1[pos_i];
+		pos->s2[pos_i] = text->s2[pos_i];
+		pos->m[pos_i] = (text->s1[pos_i] >> 24) *
+			(text->s2[pos_i] >> 24);
+		pos->m[pos_i] &= ctx->hx_orig->key_mask;
+		pos->v[pos_i] = ctx->hx_orig->v;
+		pos->cs[pos_i] = ctx->hx_orig->cs;
+		pos->idx[pos_i] = 0;
+		pos->jmp[pos_i] = 0;
+
+		++ctx->mask.count[pos->m[pos_i]];
+
+		dbg("pos[%zu] s1 %#x s2 %#x len %zu\n",
+		    pos_i, text->s1[pos_i], text->s2[pos_i], pair->len);
+	}
 
-		free(arg_m);
-		free(arg_x);
+	hxb_mask_build(&ctx->mask, ctx->sz_key);
+
+	/* the root advances every position, in order */
+	for (pos_i = kpa.count; pos_i--; ) {
+		pos->next[pos_i] = ctx->wait.ready;
+		ctx->wait.ready = pos_i;
 	}
+	ctx->wait.live = kpa.count;
 
-	return;
-err:
-	free(arg_m);
-	free(arg_x);
+	hxk_free(&kpa);
 }
 
 /* --- --- --- --- --- --- --- --- --- */
@@ -664,8 +2370,19 @@ int main(int argc, char **argv)
 	char *arg_l = NULL;
 	char *arg_h = NULL;
 	char *arg_k = NULL;
+	char *arg_s = NULL;
+	char *arg_N = NULL;
+	char *arg_T = NULL;
+	char *arg_J = NULL;
+	char *arg_M = NULL;
+	char *arg_t = NULL;
 
 	int opt_r = 0;
+	uint64_t seed = 0;
+	int opt_P = 0;
+	struct hxp_ctr perf;
+	size_t pos_i;
+	uint32_t thr_i;
 	uint32_t num_j = 0;
 	uint32_t num_l = 0;
 	uint32_t num_h = 0;
@@ -673,7 +2390,7 @@ int main(int argc, char **argv)
 	size_t raw_k_len = 0;
 
 	opterr = 1;
-	while ((rc = getopt(argc, argv, "f:j:l:h:k:rvz")) != -1) {
+	while ((rc = getopt(argc, argv, "f:j:l:h:k:rs:t:N:T:qPJ:M:vz")) != -1) {
 		switch (rc) {
 
 		case 'f': /* file name: string */
@@ -697,6 +2414,34 @@ int main(int argc, char **argv)
 		case 'r': /* randomize key */
 			opt_r = 1;
 			break;
+		case 's': /* random seed: numeric */
+			arg_s = optarg;
+			opt_r = 1;
+			break;
+
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+
+		case 'N': /* stop after nodes: numeric */
+			arg_N = optarg;
+			break;
+		case 'T': /* stop after seconds: numeric */
+			arg_T = optarg;
+			break;
+		case 'q': /* stop at the first solution */
+			hxb_quit_first = 1;
+			break;
+
+		case 'P': /* hardware counters */
+			opt_P = 1;
+			break;
+		case 'J': /* counters json: file name */
+			arg_J = optarg;
+			break;
+		case 'M': /* counters shared page: name */
+			arg_M = optarg;
+			break;
 
 		case 'v': /* increase verbosity */
 			++hohha_dbg_level;
@@ -736,8 +2481,31 @@ int main(int argc, char **argv)
 			"      Initialize key body (base64)\n"
 			"    -r\n"
 			"      Randomize key body and checksum\n"
+			"    -s <seed>\n"
+			"      Randomize with a seed (default: random, printed)\n"
 			"    -f <file>\n"
-			"      Read known plaintext from file\n"
+			"      Read known plaintext from file (text or binary)\n"
+			"    -t <threads>\n"
+			"      Search with threads (default: 1)\n"
+			"\n"
+			"  Limits:\n"
+			"    -N <nodes>\n"
+			"      Stop after a number of search nodes\n"
+			"    -T <seconds>\n"
+			"      Stop after a number of seconds\n"
+			"    -q\n"
+			"      Stop at the first solution\n"
+			"    -P\n"
+			"      Count cycles, instructions, branch and cache misses\n"
+			"      (of the first thread)\n"
+			"\n"
+			"  Counters:\n"
+			"    -J <file>\n"
+			"      Append search counters as json on SIGUSR1 and at exit\n"
+			"      (- for stderr)\n"
+			"    -M <name>\n"
+			"      Publish search counters to a shared page, each second\n"
+			"      (like /hohha_brut, see hohha_bmon)\n"
 			"\n"
 			"  -v\n"
 			"      Increase debug verbosity (may be repeated)\n"
@@ -766,7 +2534,7 @@ int main(int argc, char **argv)
 
 		errno = 0;
 		val = strtoul(arg_l, NULL, 0);
-		if (errno || val > UINT32_MAX) {
+		if (errno || !val || val > UINT32_MAX || !is_pow2(val)) {
 			fprintf(stderr, "invalid -l '%s'\n", arg_l);
 			exit(1);
 		}
@@ -787,6 +2555,100 @@ int main(int argc, char **argv)
 		num_h = (uint32_t)val;
 	}
 
+	if (arg_s) {
+		unsigned long long val;
+
+		errno = 0;
+		val = strtoull(arg_s, NULL, 0);
+		if (errno) {
+			fprintf(stderr, "invalid -s '%s'\n", arg_s);
+			exit(1);
+		}
+
+		seed = val;
+	} else if (opt_r) {
+		if (getrandom(&seed, sizeof(seed), 0) != sizeof(seed)) {
+			fprintf(stderr, "getrandom failed\n");
+			exit(1);
+		}
+
+		fprintf(stderr, "seed: %#" PRIx64 "\n", seed);
+	}
+
+	if (arg_t) {
+		unsigned long val;
+
+		errno = 0;
+		val = strtoul(arg_t, NULL, 0);
+		if (errno || !val || val > HXB_BSTAT_MAX) {
+			fprintf(stderr, "invalid -t '%s'\n", arg_t);
+			exit(1);
+		}
+
+		hxb_threads = (uint32_t)val;
+	}
+
+	if (arg_N) {
+		unsigned long long val;
+
+		errno = 0;
+		val = strtoull(arg_N, NULL, 0);
+		if (errno || !val) {
+			fprintf(stderr, "invalid -N '%s'\n", arg_N);
+			exit(1);
+		}
+
+		hxb_max_nodes = val;
+	}
+
+	if (arg_T) {
+		char *end;
+
+		errno = 0;
+		hxb_max_secs = strtod(arg_T, &end);
+		if (errno || *end || !(hxb_max_secs > 0)) {
+			fprintf(stderr, "invalid -T '%s'\n", arg_T);
+			exit(1);
+		}
+	}
+
+	if (arg_J) {
+		if (!strcmp(arg_J, "-"))
+			hxb_bstat_json = stderr;
+		else
+			hxb_bstat_json = fopen(arg_J, "a");
+		if (!hxb_bstat_json) {
+			fprintf(stderr, "invalid -J '%s'\n", arg_J);
+			exit(1);
+		}
+	}
+
+	if (arg_M) {
+		hxb_bstat_shm = hxbs_shm_create(arg_M);
+		if (!hxb_bstat_shm) {
+			fprintf(stderr, "invalid -M '%s'\n", arg_M);
+			exit(1);
+		}
+	}
+
+	hxb_bstat_time = hxb_bstat_json || hxb_bstat_shm;
+
+#ifdef __x86_64__
+	hxb_bmi2 = __builtin_cpu_supports("bmi2");
+#endif
+
+	hxb_thr = calloc(hxb_threads, sizeof(*hxb_thr));
+	for (thr_i = 0; thr_i < hxb_threads; ++thr_i) {
+		hxb_thr[thr_i].idx = thr_i;
+		hxb_thr[thr_i].seed = thr_i;
+		pthread_mutex_init(&hxb_thr[thr_i].dq.lock, NULL);
+	}
+
+	/* this is the first thread, and searches from the root */
+	hxb_self = &hxb_thr[0];
+	hxb_free_new();
+	hxb_bstat_new();
+
 	if (arg_k) {
 		rc = b64_decode(arg_k, strlen(arg_k), NULL, &raw_k_len);
 		if (rc) {
@@ -806,19 +2668,27 @@ int main(int argc, char **argv)
 	ctx.sz_key = num_l;
 	ctx.sz_hx = sizeof(*ctx.hx_orig) + ctx.sz_key;
 	ctx.pos_count = 0;
-	ctx.pos = NULL;
+	ctx.text = NULL;
 	ctx.hx_orig = malloc(ctx.sz_hx);
-	ctx.hx_mask = malloc(ctx.sz_hx);
 	ctx.ord = malloc(sizeof(*ctx.ord) +
 			 sizeof(*ctx.ord->m) * ctx.sz_key);
 	ctx.ord->next = 0;
 	ctx.ord->count = 0;
 
 	memset(ctx.hx_orig, 0, ctx.sz_hx);
-	memset(ctx.hx_mask, 0, ctx.sz_hx);
 
-	if (opt_r)
-		getrandom(ctx.hx_orig, ctx.sz_hx, 0);
+	if (opt_r) {
+		uint8_t *raw = (uint8_t *)ctx.hx_orig;
+		uint64_t word = 0;
+		size_t i;
+
+		for (i = 0; i < ctx.sz_hx; ++i) {
+			if (!(i & 7))
+				word = splitmix64(&seed);
+			raw[i] = u8(word);
+			word >>= 8;
+		}
+	}
 	if (arg_k)
 		memcpy(ctx.hx_orig->key, raw_k, raw_k_len);
 
@@ -836,6 +2706,13 @@ int main(int argc, char **argv)
 	if (arg_h)
 		ctx.hx_orig->v = num_h;
 
+	if (opt_P) {
+		if (!hxp_open(&perf))
+			pr("hardware counters not available\n");
+		hxb_perf = &perf;
+		hxp_begin(hxb_perf, &hxb_perf_read);
+	}
+
 	if (arg_f) {
 		FILE *f = fopen(arg_f, "r");
 		if (!f) {
@@ -850,7 +2727,44 @@ int main(int argc, char **argv)
 
 	signal(SIGUSR1, catch_sigusr1);
 
+	clock_gettime(CLOCK_MONOTONIC, &hxb_ts_start);
+
+	if (hxb_perf) {
+		hxp_end(hxb_perf, &hxb_perf_read);
+		for (pos_i = 0; pos_i < ctx.pos_count; ++pos_i)
+			hxb_perf_bytes += ctx.text->len[pos_i];
+		hxp_begin(hxb_perf, &hxb_perf_search);
+	}
+
+	hxb_pending = 1;
+
+	for (thr_i = 1; thr_i < hxb_threads; ++thr_i)
+		pthread_create(&hxb_thr[thr_i].thr, NULL, hxb_thr_run,
+			       &hxb_thr[thr_i]);
+
 	hxb_ctx_brut(&ctx);
+	hxb_task_done();
+	hxb_work();
+
+	for (thr_i = 1; thr_i < hxb_threads; ++thr_i)
+		pthread_join(hxb_thr[thr_i].thr, NULL);
+
+	hxb_stats_show(stderr);
+
+	if (hxb_bstat_json) {
+		hxb_bstat_show(hxb_bstat_json);
+		if (hxb_bstat_json != stderr)
+			fclose(hxb_bstat_json);
+	}
+
+	if (hxb_bstat_shm)
+		hxb_bstat_publish(hxb_secs(), 1);
+
+	if (hxb_perf) {
+		hxp_end(hxb_perf, &hxb_perf_search);
+		hxb_perf_show(stderr, hxb_bstat->nodes);
+		hxp_close(hxb_perf);
+	}
 
 	return 0;
 }
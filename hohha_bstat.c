@@ -0,0 +1,129 @@
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "hohha_bstat.h"
+
+struct hxbs_page *hxbs_shm_create(const char *name)
+{
+	struct hxbs_page *shm;
+	int fd;
+
+	fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, sizeof(*shm))) {
+		close(fd);
+		return NULL;
+	}
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	close(fd);
+
+	if (shm == MAP_FAILED)
+		return NULL;
+
+	return shm;
+}
+
+struct hxbs_page *hxbs_shm_open(const char *name)
+{
+	struct hxbs_page *shm;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0)
+		return NULL;
+
+	shm = mmap(NULL, sizeof(*shm), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (shm == MAP_FAILED)
+		return NULL;
+
+	return shm;
+}
+
+void hxbs_shm_publish(struct hxbs_page *shm, struct hxbs_page *page)
+{
+	uint64_t seq = __atomic_load_n(&shm->seq, __ATOMIC_RELAXED);
+
+	/* odd: readers retry until the page is written */
+	__atomic_store_n(&shm->seq, seq | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy((uint8_t *)shm + sizeof(shm->magic) + sizeof(shm->version) +
+	       sizeof(shm->seq),
+	       (uint8_t *)page + sizeof(page->magic) + sizeof(page->version) +
+	       sizeof(page->seq),
+	       sizeof(*page) - sizeof(page->magic) - sizeof(page->version) -
+	       sizeof(page->seq));
+	shm->magic = HXBS_MAGIC;
+	shm->version = HXBS_VERSION;
+
+	__atomic_store_n(&shm->seq, (seq | 1) + 1, __ATOMIC_RELEASE);
+}
+
+int hxbs_shm_read(struct hxbs_page *shm, struct hxbs_page *page)
+{
+	uint64_t seq;
+
+	for (;;) {
+		seq = __atomic_load_n(&shm->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			sched_yield();
+			continue;
+		}
+
+		memcpy(page, shm, sizeof(*page));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&shm->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+
+	if (page->magic != HXBS_MAGIC || page->version != HXBS_VERSION ||
+	    page->depth_count > HXBS_DEPTH)
+		return -1;
+
+	return 0;
+}
+
+void hxbs_json(FILE *f, struct hxbs_page *page)
+{
+	struct hxbs_depth *d;
+	uint64_t ns_self;
+	uint32_t i;
+
+	fprintf(f, "{\"pid\":%u,\"threads\":%u,\"secs\":%.3f,"
+		"\"nodes\":%" PRIu64 ",\"solutions\":%" PRIu64 ","
+		"\"pos_adv\":%" PRIu64 ",\"bytes\":%" PRIu64 ","
+		"\"dup_bytes\":%" PRIu64 ",\"undo_bytes\":%" PRIu64 ","
+		"\"depth_max\":%u,\"depth\":[",
+		page->pid, page->threads, page->ns * 1e-9, page->nodes,
+		page->solutions, page->pos_adv, page->bytes, page->dup_bytes,
+		page->undo_bytes, page->depth_max);
+
+	for (i = 0; i < page->depth_count; ++i) {
+		d = &page->depth[i];
+
+		/* the time of each node, without the nodes deeper */
+		ns_self = d->ns;
+		if (i + 1 < page->depth_count && ns_self > d[1].ns)
+			ns_self -= d[1].ns;
+
+		fprintf(f, "%s\n{\"depth\":%u,\"nodes\":%" PRIu64 ","
+			"\"backtracks\":%" PRIu64 ",\"v_branches\":%" PRIu64 ","
+			"\"m_branches\":%" PRIu64 ",\"ns\":%" PRIu64 ","
+			"\"self_ns\":%" PRIu64 "}",
+			i ? "," : "", i, d->nodes, d->backtracks, d->v_branches,
+			d->m_branches, d->ns, ns_self);
+	}
+
+	fprintf(f, "\n]}");
+}
@@ -0,0 +1,89 @@
+#ifndef HOHHA_BSTAT_H
+#define HOHHA_BSTAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Counters of the search of hohha_brut, and a page to export them.
+ *
+ * The page has a fixed layout, so that it can be shared with a monitor in
+ * another process, by POSIX shared memory (see shm_open).  The search
+ * publishes the page every so often, and a monitor reads it at any time,
+ * without a signal and without a lock.  The page is a seqlock: the
+ * sequence is odd while the page is written, and a reader retries until it
+ * reads the same even sequence before and after copying the page.
+ */
+
+#define HXBS_MAGIC 0x54534248 /* "HBST" */
+#define HXBS_VERSION 2
+
+/* depths in the page, deeper nodes are counted in the last */
+#define HXBS_DEPTH 256
+
+struct hxbs_depth {
+	uint64_t nodes;			/* nodes expanded */
+	uint64_t backtracks;		/* nodes whose guess was wrong */
+	uint64_t v_branches;		/* children guessing bits of v */
+	uint64_t m_branches;		/* children guessing a key byte */
+	uint64_t ns;			/* time in nodes, with children */
+};
+
+struct hxbs_page {
+	uint32_t magic;			/* HXBS_MAGIC */
+	uint32_t version;		/* HXBS_VERSION */
+	uint64_t seq;			/* odd while writing */
+	uint32_t pid;			/* process of the search */
+	uint32_t threads;		/* threads of the search */
+	uint32_t depth_max;		/* deepest node */
+	uint32_t depth_count;		/* depths in the page */
+	uint64_t ns;			/* time since the start */
+	uint64_t nodes;			/* nodes expanded */
+	uint64_t solutions;		/* solutions found */
+	uint64_t pos_adv;		/* positions advanced */
+	uint64_t bytes;			/* bytes stepped */
+	uint64_t dup_bytes;		/* bytes copied by hxb_ctx_dup */
+	uint64_t undo_bytes;		/* bytes recorded to undo changes */
+	struct hxbs_depth depth[HXBS_DEPTH];
+};
+
+/**
+ * Create, or open for writing, a shared page.
+ *
+ * Returns the mapped page, or NULL if it could not be created.
+ *
+ * @name - name of the page, for shm_open, like "/hohha_brut"
+ */
+struct hxbs_page *hxbs_shm_create(const char *name);
+
+/**
+ * Open a shared page for reading.
+ *
+ * Returns the mapped page, or NULL if it could not be opened.
+ */
+struct hxbs_page *hxbs_shm_open(const char *name);
+
+/**
+ * Copy counters to a shared page, as the writer of the seqlock.
+ *
+ * @shm - shared page
+ * @page - counters to publish
+ */
+void hxbs_shm_publish(struct hxbs_page *shm, struct hxbs_page *page);
+
+/**
+ * Copy a shared page, as a reader of the seqlock.
+ *
+ * Returns zero, or nonzero if the page is not valid.
+ *
+ * @shm - shared page
+ * @page - copy of the counters
+ */
+int hxbs_shm_read(struct hxbs_page *shm, struct hxbs_page *page);
+
+/**
+ * Print the counters as one JSON object, without a newline after it.
+ */
+void hxbs_json(FILE *f, struct hxbs_page *page);
+
+#endif
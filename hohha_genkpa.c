@@ -0,0 +1,369 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_kpa.h"
+
+/* pairs generated by each thread at a time */
+#define HXG_BATCH (1u << 12)
+
+struct hxg_ctx {
+	uint64_t seed;			/* seed of all random data */
+	uint32_t msg_len;		/* length of each message */
+	int opt_b;			/* binary format */
+	size_t sz_hx;			/* size of state */
+	struct hx_state *hx_orig;	/* initialized key */
+};
+
+struct hxg_job {
+	struct hxg_ctx *ctx;
+	uint64_t first;			/* index of first pair */
+	uint64_t count;			/* number of pairs */
+	uint8_t *out;			/* formatted pairs */
+	size_t out_len;			/* length of formatted pairs */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void *hxg_job_run(void *arg)
+{
+	struct hxg_job *job = arg;
+	struct hxg_ctx *ctx = job->ctx;
+	struct hx_state *hx;
+	struct hxk_pair pair;
+	uint64_t i, state;
+	size_t rec_len;
+
+	if (ctx->opt_b)
+		rec_len = hxk_bin_len(ctx->msg_len);
+	else
+		rec_len = hxk_text_len(ctx->msg_len);
+
+	hx = malloc(ctx->sz_hx);
+	pair.mesg = malloc(ctx->msg_len);
+	pair.ciph = malloc(ctx->msg_len);
+	pair.len = ctx->msg_len;
+
+	job->out = realloc(job->out, rec_len * job->count);
+	job->out_len = 0;
+
+	for (i = job->first; i < job->first + job->count; ++i) {
+		state = splitmix64_stream(ctx->seed, i);
+		splitmix64_fill(&state, pair.salt, 8);
+		splitmix64_fill(&state, pair.mesg, pair.len);
+
+		memcpy(hx, ctx->hx_orig, ctx->sz_hx);
+		hx_init_salt(hx, hxk_pair_s1(&pair), hxk_pair_s2(&pair));
+		hx_encrypt(hx, pair.mesg, pair.ciph, pair.len);
+
+		if (ctx->opt_b)
+			job->out_len += hxk_fmt_bin(job->out + job->out_len,
+						    &pair);
+		else
+			job->out_len += hxk_fmt_text((char *)job->out +
+						     job->out_len, &pair);
+	}
+
+	free(pair.mesg);
+	free(pair.ciph);
+	free(hx);
+
+	return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxg_arg_num(char *arg, char opt, int min)
+{
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(arg, NULL, 0);
+	if (errno || val < min || val > UINT32_MAX) {
+		fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+		exit(1);
+	}
+
+	return (uint32_t)val;
+}
+
+int main(int argc, char **argv)
+{
+	struct hxg_ctx ctx;
+	struct hxg_job *job;
+	pthread_t *thr;
+	FILE *out = stdout;
+
+	int rc, errflg = 0;
+
+	char *arg_j = NULL;
+	char *arg_l = NULL;
+	char *arg_n = NULL;
+	char *arg_L = NULL;
+	char *arg_k = NULL;
+	char *arg_s = NULL;
+	char *arg_t = NULL;
+	char *arg_o = NULL;
+	char *arg_K = NULL;
+
+	uint32_t num_j, num_l;
+	uint64_t num_n;
+	uint32_t num_t = 1;
+	uint64_t i, next;
+	uint32_t t, used;
+
+	uint8_t *raw_k = NULL;
+	size_t raw_k_len = 0;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.msg_len = 128;
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "j:l:n:L:k:s:t:bo:K:v")) != -1) {
+		switch (rc) {
+		case 'j': /* key jumps: numeric */
+			arg_j = optarg;
+			break;
+		case 'l': /* key length: numeric */
+			arg_l = optarg;
+			break;
+		case 'k': /* key body: base64 */
+			arg_k = optarg;
+			break;
+
+		case 'n': /* number of pairs: numeric */
+			arg_n = optarg;
+			break;
+		case 'L': /* message length: numeric */
+			arg_L = optarg;
+			break;
+
+		case 's': /* random seed: numeric */
+			arg_s = optarg;
+			break;
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+
+		case 'b': /* binary format */
+			ctx.opt_b = 1;
+			break;
+		case 'o': /* output file: string */
+			arg_o = optarg;
+			break;
+		case 'K': /* key output file: string */
+			arg_K = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_j || !arg_l || !arg_n) {
+		fprintf(stderr, "missing one of the required options\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s <options> [-v]\n"
+			"\n"
+			"  Options:\n"
+			"    -j <jumps>\n"
+			"      Key jumps (numeric) (required)\n"
+			"    -l <length>\n"
+			"      Key length (numeric) (required)\n"
+			"    -n <count>\n"
+			"      Number of known plaintext pairs (required)\n"
+			"    -L <length>\n"
+			"      Length of each message (default: 128)\n"
+			"    -k <body>\n"
+			"      Key body (base64) (default: random)\n"
+			"    -s <seed>\n"
+			"      Seed of random key and pairs (default: random)\n"
+			"    -t <threads>\n"
+			"      Number of threads (default: 1)\n"
+			"    -b\n"
+			"      Write the binary format (see hohha_kpa.h)\n"
+			"    -o <file>\n"
+			"      Write pairs to file (default: stdout)\n"
+			"    -K <file>\n"
+			"      Write the key body to file\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	num_j = hxg_arg_num(arg_j, 'j', 2);
+	num_l = hxg_arg_num(arg_l, 'l', 1);
+	if (!is_pow2(num_l)) {
+		fprintf(stderr, "invalid -l '%s'\n", arg_l);
+		exit(1);
+	}
+
+	{ /* arg_n */
+		unsigned long long val;
+
+		errno = 0;
+		val = strtoull(arg_n, NULL, 0);
+		if (errno) {
+			fprintf(stderr, "invalid -n '%s'\n", arg_n);
+			exit(1);
+		}
+
+		num_n = val;
+	}
+
+	if (arg_L)
+		ctx.msg_len = hxg_arg_num(arg_L, 'L', 1);
+
+	if (arg_t)
+		num_t = hxg_arg_num(arg_t, 't', 1);
+
+	if (arg_s) {
+		unsigned long long val;
+
+		errno = 0;
+		val = strtoull(arg_s, NULL, 0);
+		if (errno) {
+			fprintf(stderr, "invalid -s '%s'\n", arg_s);
+			exit(1);
+		}
+
+		ctx.seed = val;
+	} else {
+		if (getrandom(&ctx.seed, sizeof(ctx.seed), 0) !=
+		    sizeof(ctx.seed)) {
+			fprintf(stderr, "getrandom failed\n");
+			exit(1);
+		}
+
+		fprintf(stderr, "seed: %#" PRIx64 "\n", ctx.seed);
+	}
+
+	if (arg_k) {
+		rc = b64_decode(arg_k, strlen(arg_k), NULL, &raw_k_len);
+		if (rc || raw_k_len != num_l) {
+			fprintf(stderr, "invalid -k '%s'\n", arg_k);
+			exit(1);
+		}
+
+		raw_k = malloc(raw_k_len);
+
+		b64_decode(arg_k, strlen(arg_k), raw_k, &raw_k_len);
+	} else {
+		/* the key is the stream past the last pair */
+		uint64_t state = splitmix64_stream(ctx.seed, UINT64_MAX);
+
+		raw_k_len = num_l;
+		raw_k = malloc(raw_k_len);
+
+		splitmix64_fill(&state, raw_k, raw_k_len);
+	}
+
+	if (arg_K) {
+		size_t data_len = (raw_k_len * 4 / 3 + 3) & ~3;
+		char *data = malloc(data_len + 1);
+		FILE *f = fopen(arg_K, "w");
+
+		if (!f) {
+			fprintf(stderr, "invalid -K '%s'\n", arg_K);
+			exit(1);
+		}
+
+		b64_encode(raw_k, raw_k_len, data, data_len + 1);
+		fprintf(f, "%s\n", data);
+		fclose(f);
+		free(data);
+	}
+
+	if (arg_o) {
+		out = fopen(arg_o, "w");
+		if (!out) {
+			fprintf(stderr, "invalid -o '%s'\n", arg_o);
+			exit(1);
+		}
+	}
+
+	ctx.sz_hx = sizeof(*ctx.hx_orig) + num_l;
+	ctx.hx_orig = malloc(ctx.sz_hx);
+	hx_init(ctx.hx_orig, raw_k, num_l, num_j, 0, 0, 0);
+
+	if (ctx.opt_b && hxk_write_head(out, num_j, num_l,
+					ctx.msg_len, num_n)) {
+		fprintf(stderr, "write failed\n");
+		exit(1);
+	}
+
+	job = calloc(num_t, sizeof(*job));
+	thr = calloc(num_t, sizeof(*thr));
+
+	for (i = 0; i < num_n; i = next) {
+		next = i;
+
+		for (t = 0; t < num_t && next < num_n; ++t) {
+			job[t].ctx = &ctx;
+			job[t].first = next;
+			job[t].count = num_n - next;
+			if (job[t].count > HXG_BATCH)
+				job[t].count = HXG_BATCH;
+			next += job[t].count;
+
+			if (num_t == 1)
+				hxg_job_run(&job[t]);
+			else
+				pthread_create(&thr[t], NULL,
+					       hxg_job_run, &job[t]);
+		}
+
+		used = t;
+
+		for (t = 0; t < used && num_t != 1; ++t)
+			pthread_join(thr[t], NULL);
+
+		for (t = 0; t < used; ++t) {
+			if (fwrite(job[t].out, 1, job[t].out_len, out) !=
+			    job[t].out_len) {
+				fprintf(stderr, "write failed\n");
+				exit(1);
+			}
+		}
+
+		vdbg("pairs: %" PRIu64 "\n", next);
+	}
+
+	if (fclose(out)) {
+		fprintf(stderr, "write failed\n");
+		exit(1);
+	}
+
+	for (t = 0; t < num_t; ++t)
+		free(job[t].out);
+
+	free(job);
+	free(thr);
+	free(ctx.hx_orig);
+	free(raw_k);
+
+	return 0;
+}
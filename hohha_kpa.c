@@ -0,0 +1,244 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hohha_kpa.h"
+#include "hohha_util.h"
+
+#define HXK_HEAD_LEN 32
+
+static void hxk_put_le32(uint8_t *buf, uint32_t word)
+{
+	buf[0] = u8(word);
+	buf[1] = u8(word >> 8);
+	buf[2] = u8(word >> 16);
+	buf[3] = u8(word >> 24);
+}
+
+static void hxk_put_le64(uint8_t *buf, uint64_t word)
+{
+	hxk_put_le32(buf, u32(word));
+	hxk_put_le32(buf + 4, u32(word >> 32));
+}
+
+static uint64_t hxk_get_le64(uint8_t *buf)
+{
+	return leu32(buf) | ((uint64_t)leu32(buf + 4) << 32);
+}
+
+static void hxk_add(struct hxk_kpa *kpa, struct hxk_pair *pair)
+{
+	size_t i = kpa->count;
+
+	if (!i)
+		kpa->pair = malloc(sizeof(*kpa->pair));
+	else if (is_pow2(i))
+		kpa->pair = realloc(kpa->pair, sizeof(*kpa->pair) * (i << 1));
+
+	kpa->pair[i] = *pair;
+	kpa->count = i + 1;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxk_read_text(struct hxk_kpa *kpa, FILE *f)
+{
+	struct hxk_pair pair;
+	uint8_t *raw_S = pair.salt;
+	char *arg_m;
+	char *arg_x;
+	size_t raw_m_len;
+	size_t raw_x_len;
+	int rc;
+
+	for (;;) {
+		arg_m = NULL;
+		arg_x = NULL;
+
+		rc = fscanf(f, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu %ms %ms",
+			    &raw_S[0], &raw_S[1], &raw_S[2], &raw_S[3],
+			    &raw_S[4], &raw_S[5], &raw_S[6], &raw_S[7],
+			    &arg_m, &arg_x);
+
+		if (rc != 10)
+			goto err;
+
+		if (b64_decode(arg_m, strlen(arg_m), NULL, &raw_m_len))
+			goto err;
+
+		if (b64_decode(arg_x, strlen(arg_x), NULL, &raw_x_len))
+			goto err;
+
+		if (raw_m_len != raw_x_len)
+			goto err;
+
+		pair.mesg = malloc(raw_m_len);
+		pair.ciph = malloc(raw_x_len);
+		pair.len = raw_x_len;
+
+		b64_decode(arg_m, strlen(arg_m), pair.mesg, &raw_m_len);
+		b64_decode(arg_x, strlen(arg_x), pair.ciph, &raw_x_len);
+
+		hxk_add(kpa, &pair);
+
+		free(arg_m);
+		free(arg_x);
+	}
+
+err:
+	free(arg_m);
+	free(arg_x);
+}
+
+static int hxk_read_bin(struct hxk_kpa *kpa, FILE *f, uint8_t *head)
+{
+	struct hxk_pair pair;
+	uint64_t i, count;
+	uint32_t len;
+	uint8_t *rec;
+
+	if (fread(head + 8, HXK_HEAD_LEN - 8, 1, f) != 1)
+		return -1;
+
+	if (leu32(head + 8) != HXK_VERSION)
+		return -1;
+
+	kpa->key_jumps = leu32(head + 12);
+	kpa->key_len = leu32(head + 16);
+	len = leu32(head + 20);
+	count = hxk_get_le64(head + 24);
+
+	if (!count)
+		return 0;
+
+	if (count > SIZE_MAX / hxk_bin_len(len))
+		return -1;
+
+	kpa->data = malloc(count * hxk_bin_len(len));
+	if (!kpa->data)
+		return -1;
+
+	if (fread(kpa->data, hxk_bin_len(len), count, f) != count)
+		return -1;
+
+	kpa->pair = malloc(sizeof(*kpa->pair) * count);
+	if (!kpa->pair)
+		return -1;
+
+	for (i = 0; i < count; ++i) {
+		rec = kpa->data + i * hxk_bin_len(len);
+		memcpy(pair.salt, rec, 8);
+		pair.mesg = rec + 8;
+		pair.ciph = rec + 8 + len;
+		pair.len = len;
+		kpa->pair[i] = pair;
+	}
+
+	kpa->count = count;
+
+	return 0;
+}
+
+int hxk_read(struct hxk_kpa *kpa, FILE *f)
+{
+	uint8_t head[HXK_HEAD_LEN];
+	int c;
+
+	memset(kpa, 0, sizeof(*kpa));
+
+	c = getc(f);
+	if (c == EOF)
+		return 0;
+
+	if (c != HXK_MAGIC[0]) {
+		ungetc(c, f);
+		hxk_read_text(kpa, f);
+		return 0;
+	}
+
+	head[0] = c;
+	if (fread(head + 1, 7, 1, f) != 1 || memcmp(head, HXK_MAGIC, 8))
+		return -1;
+
+	kpa->bin = 1;
+	return hxk_read_bin(kpa, f, head);
+}
+
+void hxk_free(struct hxk_kpa *kpa)
+{
+	size_t i;
+
+	if (!kpa->data) {
+		for (i = 0; i < kpa->count; ++i) {
+			free(kpa->pair[i].mesg);
+			free(kpa->pair[i].ciph);
+		}
+	}
+
+	free(kpa->pair);
+	free(kpa->data);
+
+	memset(kpa, 0, sizeof(*kpa));
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static size_t hxk_b64_len(size_t len)
+{
+	return (len * 4 / 3 + 3) & ~3;
+}
+
+size_t hxk_text_len(size_t len)
+{
+	/* salt: eight numbers up to "255 " and newline */
+	return 32 + 2 * (hxk_b64_len(len) + 1) + 1;
+}
+
+size_t hxk_fmt_text(char *buf, struct hxk_pair *pair)
+{
+	size_t b64_len = hxk_b64_len(pair->len);
+	uint8_t *s = pair->salt;
+	char *out = buf;
+
+	out += sprintf(out, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu\n",
+		       s[0], s[1], s[2], s[3], s[4], s[5], s[6], s[7]);
+
+	b64_encode(pair->mesg, pair->len, out, b64_len + 1);
+	out += b64_len;
+	*out++ = '\n';
+
+	b64_encode(pair->ciph, pair->len, out, b64_len + 1);
+	out += b64_len;
+	*out++ = '\n';
+	*out = 0;
+
+	return out - buf;
+}
+
+size_t hxk_bin_len(size_t len)
+{
+	return 8 + 2 * len;
+}
+
+size_t hxk_fmt_bin(uint8_t *buf, struct hxk_pair *pair)
+{
+	memcpy(buf, pair->salt, 8);
+	memcpy(buf + 8, pair->mesg, pair->len);
+	memcpy(buf + 8 + pair->len, pair->ciph, pair->len);
+
+	return hxk_bin_len(pair->len);
+}
+
+int hxk_write_head(FILE *f, uint32_t key_jumps, uint32_t key_len,
+		   uint32_t msg_len, uint64_t count)
+{
+	uint8_t head[HXK_HEAD_LEN];
+
+	memcpy(head, HXK_MAGIC, 8);
+	hxk_put_le32(head + 8, HXK_VERSION);
+	hxk_put_le32(head + 12, key_jumps);
+	hxk_put_le32(head + 16, key_len);
+	hxk_put_le32(head + 20, msg_len);
+	hxk_put_le64(head + 24, count);
+
+	return fwrite(head, sizeof(head), 1, f) != 1;
+}
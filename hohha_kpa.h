@@ -0,0 +1,126 @@
+#ifndef HOHHA_KPA_H
+#define HOHHA_KPA_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Known plaintext (KPA) corpus: pairs of plain and cipher text, with salt.
+ *
+ * The text format is three lines per pair: eight numeric bytes of salt, the
+ * base64 plain text, and the base64 cipher text, as written by genbrut.sh.
+ *
+ * The binary format is a header of 32 bytes, followed by records of eight
+ * bytes of salt, the plain text, and the cipher text.  All messages in a
+ * binary corpus are the same length.  The header is, in little endian:
+ *
+ *   char magic[8];		HXK_MAGIC
+ *   uint32_t version;		HXK_VERSION
+ *   uint32_t key_jumps;	number of jumps, or zero
+ *   uint32_t key_len;		length of key body, or zero
+ *   uint32_t msg_len;		length of each message
+ *   uint64_t count;		number of pairs
+ */
+
+#define HXK_MAGIC "HOHHAKPA"
+#define HXK_VERSION 1
+
+struct hxk_pair {
+	uint8_t salt[8];		/* salt bytes */
+	uint8_t *mesg;			/* cleartext message */
+	uint8_t *ciph;			/* ciphertext message */
+	size_t len;			/* length of message */
+};
+
+struct hxk_kpa {
+	uint32_t key_jumps;		/* number of jumps, if known */
+	uint32_t key_len;		/* length of key body, if known */
+	size_t count;			/* number of pairs */
+	struct hxk_pair *pair;		/* known plaintext pairs */
+	uint8_t *data;			/* message data of binary corpus */
+	int bin;			/* read from a binary corpus */
+};
+
+/**
+ * First salt of a pair, as used by hx_init_salt.
+ */
+static inline uint32_t hxk_pair_s1(struct hxk_pair *pair)
+{
+	return pair->salt[0] | (pair->salt[1] << 8) |
+		(pair->salt[2] << 16) | ((uint32_t)pair->salt[3] << 24);
+}
+
+/**
+ * Second salt of a pair, as used by hx_init_salt.
+ */
+static inline uint32_t hxk_pair_s2(struct hxk_pair *pair)
+{
+	return pair->salt[4] | (pair->salt[5] << 8) |
+		(pair->salt[6] << 16) | ((uint32_t)pair->salt[7] << 24);
+}
+
+/**
+ * Read a corpus in either format.
+ *
+ * Text is read until the end of the file, or the first invalid pair.
+ * Returns zero, or nonzero if a binary corpus is truncated or invalid.
+ *
+ * @kpa - corpus to initialize
+ * @f - file to read
+ */
+int hxk_read(struct hxk_kpa *kpa, FILE *f);
+
+/**
+ * Free the pairs of a corpus.
+ */
+void hxk_free(struct hxk_kpa *kpa);
+
+/**
+ * Length of a pair in the text format, including the null character.
+ *
+ * @len - length of message
+ */
+size_t hxk_text_len(size_t len);
+
+/**
+ * Format a pair in the text format.
+ *
+ * Returns the length of the text, not including the null character.
+ *
+ * @buf - destination of at least hxk_text_len() bytes
+ * @pair - pair to format
+ */
+size_t hxk_fmt_text(char *buf, struct hxk_pair *pair);
+
+/**
+ * Length of a pair in the binary format.
+ *
+ * @len - length of message
+ */
+size_t hxk_bin_len(size_t len);
+
+/**
+ * Format a pair in the binary format.
+ *
+ * Returns the length of the record.
+ *
+ * @buf - destination of at least hxk_bin_len() bytes
+ * @pair - pair to format
+ */
+size_t hxk_fmt_bin(uint8_t *buf, struct hxk_pair *pair);
+
+/**
+ * Write the header of a binary corpus.
+ *
+ * Returns zero, or nonzero if the header could not be written.
+ *
+ * @f - file to write
+ * @key_jumps - number of jumps, or zero
+ * @key_len - length of key body, or zero
+ * @msg_len - length of each message
+ * @count - number of pairs to follow
+ */
+int hxk_write_head(FILE *f, uint32_t key_jumps, uint32_t key_len,
+		   uint32_t msg_len, uint64_t count);
+
+#endif
@@ -0,0 +1,576 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+
+/*
+ * Recover the key length and number of jumps, with a local oracle.
+ *
+ * This runs the attacks of attacks/solve-length.py and solve-jumps.py,
+ * but the oracle is an hx_state in the same process, instead of a script.
+ * Each query decrypts one zero byte of cipher text, with the chosen salt.
+ * See attacks/README.md for how each attack works.
+ *
+ * Every probe is repeated with several variants of the salt.  The variant
+ * bits are in the low three bytes of each salt, so the moving pointer is
+ * not changed by the variant.  A probe has an effect if the output of any
+ * variant differs from the target of the same variant.
+ */
+
+/* salt variants of each probe */
+#define HXO_VARIANTS 64
+
+/* group of probes, compared to one target */
+struct hxo_group {
+	uint32_t tgt_s1;		/* first salt of target */
+	uint32_t tgt_s2;		/* second salt of target */
+	uint32_t count;			/* number of probes */
+	int shift;			/* shift probe bit left, or right */
+	uint32_t bit_s1;		/* first probe bit of first salt */
+	uint32_t bit_s2;		/* first probe bit of second salt */
+};
+
+/* lengths as small as zero to 128 are detected */
+static const struct hxo_group hxo_len_a = {
+	0, 0x01000000, 8, 1, 0x01000000, 0,
+};
+
+/* lengths 256 to 32K are detected */
+static const struct hxo_group hxo_len_b = {
+	0, 0x80000000, 7, 1, 0x02000000, 0,
+};
+
+/* bits of the first salt that affect the output */
+static const struct hxo_group hxo_jmp_s1 = {
+	0, 0, 24, 1, 0x00000100, 0,
+};
+
+/* bits of the second salt that affect the output */
+static const struct hxo_group hxo_jmp_s2 = {
+	0, 0, 32, -1, 0, 0x80000000,
+};
+
+struct hxo_oracle {
+	size_t sz_hx;			/* size of state */
+	struct hx_state *hx_orig;	/* secret key */
+	struct hx_state *hx;		/* state of each query */
+	uint32_t num_v;			/* number of variants */
+	uint32_t *var_s1;		/* variant bits of first salt */
+	uint32_t *var_s2;		/* variant bits of second salt */
+	uint8_t *tgt;			/* target output of each variant */
+	uint64_t queries;		/* number of queries */
+};
+
+struct hxo_result {
+	uint32_t key_jumps;		/* actual jumps */
+	uint32_t key_len;		/* actual length */
+	uint32_t len_effect;		/* salt bits affecting the pointer */
+	uint32_t s1_effect;		/* first salt bits affecting output */
+	uint32_t s2_effect;		/* second salt bits affecting output */
+	uint32_t jumps;			/* recovered jumps */
+	uint32_t len;			/* recovered length */
+};
+
+struct hxo_ctx {
+	uint64_t seed;			/* seed of all random keys */
+	uint32_t num_v;			/* number of variants */
+	uint32_t j_min, j_max;		/* range of key jumps */
+	uint32_t l_min, l_max;		/* range of key length (log2) */
+	uint64_t count;			/* number of keys */
+	uint64_t next;			/* next key to solve */
+	uint64_t queries;		/* number of queries */
+	struct hxo_result *res;		/* result of each key */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint8_t hxo_query(struct hxo_oracle *o, uint32_t s1, uint32_t s2)
+{
+	uint8_t m = 0, x;
+
+	memcpy(o->hx, o->hx_orig, o->sz_hx);
+	hx_init_salt(o->hx, s1, s2);
+	hx_decrypt(o->hx, &m, &x, 1);
+
+	++o->queries;
+
+	return x;
+}
+
+/* the number of probes with effect, before the first without */
+static uint32_t hxo_effect(struct hxo_oracle *o, const struct hxo_group *g)
+{
+	uint32_t i, k, s1, s2;
+
+	for (i = 0; i < o->num_v; ++i)
+		o->tgt[i] = hxo_query(o,
+				      g->tgt_s1 ^ o->var_s1[i],
+				      g->tgt_s2 ^ o->var_s2[i]);
+
+	for (k = 0; k < g->count; ++k) {
+		if (g->shift > 0) {
+			s1 = g->bit_s1 << k;
+			s2 = g->bit_s2 << k;
+		} else {
+			s1 = g->bit_s1 >> k;
+			s2 = g->bit_s2 >> k;
+		}
+
+		/* the probe flips one bit of the target salt */
+		s1 ^= g->tgt_s1;
+		s2 ^= g->tgt_s2;
+
+		for (i = 0; i < o->num_v; ++i) {
+			if (o->tgt[i] != hxo_query(o,
+						   s1 ^ o->var_s1[i],
+						   s2 ^ o->var_s2[i]))
+				break;
+		}
+
+		if (i == o->num_v)
+			break;
+	}
+
+	return k;
+}
+
+static void hxo_solve(struct hxo_oracle *o, struct hxo_result *res)
+{
+	uint32_t s1_count, s2_count;
+
+	res->len_effect = hxo_effect(o, &hxo_len_a);
+	if (res->len_effect == hxo_len_a.count)
+		res->len_effect += hxo_effect(o, &hxo_len_b);
+
+	res->len = 1u << res->len_effect;
+
+	s1_count = res->s1_effect = hxo_effect(o, &hxo_jmp_s1);
+	s2_count = res->s2_effect = hxo_effect(o, &hxo_jmp_s2);
+
+	if (s2_count < s1_count)
+		s2_count = s1_count;
+	if (s1_count < s2_count)
+		s1_count = s2_count - 1;
+
+	res->jumps = s1_count + s2_count;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxo_range(uint64_t *state, uint32_t min, uint32_t max)
+{
+	return min + (uint32_t)(splitmix64(state) % (max - min + 1));
+}
+
+static void hxo_oracle_init(struct hxo_oracle *o, uint32_t num_v,
+			    uint32_t key_len)
+{
+	o->sz_hx = sizeof(*o->hx) + key_len;
+	o->hx_orig = malloc(o->sz_hx);
+	o->hx = malloc(o->sz_hx);
+	o->num_v = num_v;
+	o->var_s1 = malloc(sizeof(*o->var_s1) * num_v);
+	o->var_s2 = malloc(sizeof(*o->var_s2) * num_v);
+	o->tgt = malloc(num_v);
+	o->queries = 0;
+}
+
+static void hxo_oracle_free(struct hxo_oracle *o)
+{
+	free(o->hx_orig);
+	free(o->hx);
+	free(o->var_s1);
+	free(o->var_s2);
+	free(o->tgt);
+}
+
+/* the first variant is the plain probe, the rest are random */
+static void hxo_oracle_vary(struct hxo_oracle *o, uint64_t *state)
+{
+	uint32_t i;
+
+	o->var_s1[0] = 0;
+	o->var_s2[0] = 0;
+
+	for (i = 1; i < o->num_v; ++i) {
+		uint64_t word = splitmix64(state);
+
+		o->var_s1[i] = u32(word) & 0xffffff;
+		o->var_s2[i] = u32(word >> 32) & 0xffffff;
+	}
+}
+
+static void *hxo_run(void *arg)
+{
+	struct hxo_ctx *ctx = arg;
+	struct hxo_oracle o;
+	struct hxo_result *res;
+	uint64_t i, state;
+	uint8_t *key;
+
+	hxo_oracle_init(&o, ctx->num_v, 1u << ctx->l_max);
+	key = malloc(1u << ctx->l_max);
+
+	while ((i = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) <
+	       ctx->count) {
+		res = &ctx->res[i];
+		state = splitmix64_stream(ctx->seed, i);
+
+		res->key_jumps = hxo_range(&state, ctx->j_min, ctx->j_max);
+		res->key_len = 1u << hxo_range(&state, ctx->l_min, ctx->l_max);
+		splitmix64_fill(&state, key, res->key_len);
+		hxo_oracle_vary(&o, &state);
+
+		o.sz_hx = sizeof(*o.hx) + res->key_len;
+		hx_init(o.hx_orig, key, res->key_len, res->key_jumps, 0, 0, 0);
+
+		hxo_solve(&o, res);
+
+		dbg("key %" PRIu64 ": jumps %u len %u -> jumps %u len %u%s\n",
+		    i, res->key_jumps, res->key_len, res->jumps, res->len,
+		    (res->jumps != res->key_jumps ||
+		     res->len != res->key_len) ? " FAIL" : "");
+	}
+
+	__atomic_fetch_add(&ctx->queries, o.queries, __ATOMIC_RELAXED);
+
+	hxo_oracle_free(&o);
+	free(key);
+
+	return NULL;
+}
+
+static void hxo_report(struct hxo_ctx *ctx, double secs)
+{
+	uint64_t i, keys, len_ok, jmp_ok;
+	uint64_t all_len_ok = 0, all_jmp_ok = 0;
+	uint32_t j;
+
+	printf("%6s %8s %8s %7s %8s %7s\n",
+	       "jumps", "keys", "len_ok", "len_%", "jmp_ok", "jmp_%");
+
+	for (j = ctx->j_min; j <= ctx->j_max; ++j) {
+		keys = len_ok = jmp_ok = 0;
+
+		for (i = 0; i < ctx->count; ++i) {
+			if (ctx->res[i].key_jumps != j)
+				continue;
+			++keys;
+			len_ok += ctx->res[i].len == ctx->res[i].key_len;
+			jmp_ok += ctx->res[i].jumps == ctx->res[i].key_jumps;
+		}
+
+		all_len_ok += len_ok;
+		all_jmp_ok += jmp_ok;
+
+		if (!keys)
+			continue;
+
+		printf("%6u %8" PRIu64 " %8" PRIu64 " %7.2f %8" PRIu64
+		       " %7.2f\n", j, keys,
+		       len_ok, 100.0 * len_ok / keys,
+		       jmp_ok, 100.0 * jmp_ok / keys);
+	}
+
+	printf("keys: %" PRIu64 " length ok: %" PRIu64 " (%.2f%%)"
+	       " jumps ok: %" PRIu64 " (%.2f%%)\n",
+	       ctx->count,
+	       all_len_ok, 100.0 * all_len_ok / ctx->count,
+	       all_jmp_ok, 100.0 * all_jmp_ok / ctx->count);
+
+	printf("queries: %" PRIu64 " in %.3fs (%.0f/s)\n",
+	       ctx->queries, secs, secs > 0 ? ctx->queries / secs : 0);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxo_arg_num(char *arg, char opt, uint32_t min, uint32_t max)
+{
+	unsigned long val;
+	char *end;
+
+	errno = 0;
+	val = strtoul(arg, &end, 0);
+	if (errno || *end || val < min || val > max) {
+		fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+		exit(1);
+	}
+
+	return (uint32_t)val;
+}
+
+/* range of numbers, as <min>[:<max>] */
+static void hxo_arg_range(char *arg, char opt, uint32_t min, uint32_t max,
+			  uint32_t *lo, uint32_t *hi)
+{
+	char *sep = strchr(arg, ':');
+
+	if (sep)
+		*sep = 0;
+
+	*lo = hxo_arg_num(arg, opt, min, max);
+	*hi = sep ? hxo_arg_num(sep + 1, opt, *lo, max) : *lo;
+
+	if (sep)
+		*sep = ':';
+}
+
+static uint32_t hxo_log2(uint32_t val)
+{
+	uint32_t n = 0;
+
+	while (val >>= 1)
+		++n;
+
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	struct hxo_ctx ctx;
+	struct hxo_oracle o;
+	struct hxo_result res;
+	struct timespec ts_start, ts_end;
+	pthread_t *thr;
+
+	int rc, errflg = 0;
+
+	char *arg_K = NULL;
+	char *arg_j = NULL;
+	char *arg_l = NULL;
+	char *arg_n = NULL;
+	char *arg_V = NULL;
+	char *arg_s = NULL;
+	char *arg_t = NULL;
+
+	uint32_t num_t = 1;
+	uint32_t t;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.num_v = HXO_VARIANTS;
+	ctx.j_min = 2;
+	ctx.j_max = 32;
+	ctx.l_min = 4;
+	ctx.l_max = 8;
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "K:j:l:n:V:s:t:v")) != -1) {
+		switch (rc) {
+		case 'K': /* secret key: base64 */
+			arg_K = optarg;
+			break;
+
+		case 'j': /* random key jumps: numeric range */
+			arg_j = optarg;
+			break;
+		case 'l': /* random key length: numeric range */
+			arg_l = optarg;
+			break;
+		case 'n': /* number of random keys: numeric */
+			arg_n = optarg;
+			break;
+
+		case 'V': /* salt variants: numeric */
+			arg_V = optarg;
+			break;
+		case 's': /* random seed: numeric */
+			arg_s = optarg;
+			break;
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_K == !arg_n) {
+		fprintf(stderr, "specify exactly one of -K or -n\n");
+		++errflg;
+	}
+
+	if (arg_K && (arg_j || arg_l || arg_s || arg_t)) {
+		fprintf(stderr, "-K is not used with -j, -l, -s, or -t\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s <options> [-v]\n"
+			"\n"
+			"  Recover the key length and jumps, with a local oracle.\n"
+			"\n"
+			"  Secret key:\n"
+			"    -K <key>\n"
+			"      Solve one key (base64)\n"
+			"\n"
+			"  Random keys:\n"
+			"    -n <count>\n"
+			"      Solve this many random keys, and report accuracy\n"
+			"    -j <min>[:<max>]\n"
+			"      Key jumps (numeric) (default: 2:32)\n"
+			"    -l <min>[:<max>]\n"
+			"      Key length, a power of two (default: 16:256)\n"
+			"    -s <seed>\n"
+			"      Seed of random keys (default: random)\n"
+			"    -t <threads>\n"
+			"      Number of threads (default: 1)\n"
+			"\n"
+			"  Options:\n"
+			"    -V <variants>\n"
+			"      Salt variants of each probe (default: %u)\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0], HXO_VARIANTS);
+		exit(2);
+	}
+
+	if (arg_V)
+		ctx.num_v = hxo_arg_num(arg_V, 'V', 1, 1u << 24);
+
+	if (arg_K) {
+		uint8_t *raw_K;
+		size_t raw_K_len;
+		uint32_t num_l;
+		uint64_t state;
+
+		rc = b64_decode(arg_K, strlen(arg_K), NULL, &raw_K_len);
+		if (rc || raw_K_len < 11) {
+			fprintf(stderr, "invalid -K '%s'\n", arg_K);
+			exit(1);
+		}
+
+		raw_K = malloc(raw_K_len);
+		b64_decode(arg_K, strlen(arg_K), raw_K, &raw_K_len);
+
+		num_l = raw_K[1] | (raw_K[2] << 8);
+		if (!is_pow2(num_l) || raw_K_len - 11 < num_l) {
+			fprintf(stderr, "invalid -K '%s'\n", arg_K);
+			exit(1);
+		}
+
+		/* the variants need not be secret, only different */
+		state = 0;
+
+		hxo_oracle_init(&o, ctx.num_v, num_l);
+		hxo_oracle_vary(&o, &state);
+		hx_init(o.hx_orig, raw_K + 11, num_l, raw_K[0], 0, 0, 0);
+
+		hxo_solve(&o, &res);
+
+		printf("s1_effect: %u\n", res.s1_effect);
+		printf("s2_effect: %u\n", res.s2_effect);
+		printf("key_jumps: %u\n", res.jumps);
+		printf("len_effect: %u\n", res.len_effect);
+		printf("key_length: %u\n", res.len);
+		dbg("queries: %" PRIu64 "\n", o.queries);
+
+		hxo_oracle_free(&o);
+		free(raw_K);
+
+		return 0;
+	}
+
+	{ /* arg_n */
+		unsigned long long val;
+		char *end;
+
+		errno = 0;
+		val = strtoull(arg_n, &end, 0);
+		if (errno || *end || !val) {
+			fprintf(stderr, "invalid -n '%s'\n", arg_n);
+			exit(1);
+		}
+
+		ctx.count = val;
+	}
+
+	if (arg_j)
+		hxo_arg_range(arg_j, 'j', 2, 255, &ctx.j_min, &ctx.j_max);
+
+	if (arg_l) {
+		uint32_t lo, hi;
+
+		hxo_arg_range(arg_l, 'l', 1, 1u << 15, &lo, &hi);
+		if (!is_pow2(lo) || !is_pow2(hi)) {
+			fprintf(stderr, "invalid -l '%s'\n", arg_l);
+			exit(1);
+		}
+
+		ctx.l_min = hxo_log2(lo);
+		ctx.l_max = hxo_log2(hi);
+	}
+
+	if (arg_t)
+		num_t = hxo_arg_num(arg_t, 't', 1, 1024);
+
+	if (arg_s) {
+		unsigned long long val;
+
+		errno = 0;
+		val = strtoull(arg_s, NULL, 0);
+		if (errno) {
+			fprintf(stderr, "invalid -s '%s'\n", arg_s);
+			exit(1);
+		}
+
+		ctx.seed = val;
+	} else {
+		if (getrandom(&ctx.seed, sizeof(ctx.seed), 0) !=
+		    sizeof(ctx.seed)) {
+			fprintf(stderr, "getrandom failed\n");
+			exit(1);
+		}
+
+		fprintf(stderr, "seed: %#" PRIx64 "\n", ctx.seed);
+	}
+
+	ctx.res = calloc(ctx.count, sizeof(*ctx.res));
+	if (!ctx.res) {
+		fprintf(stderr, "invalid -n '%s'\n", arg_n);
+		exit(1);
+	}
+
+	thr = calloc(num_t, sizeof(*thr));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	if (num_t == 1) {
+		hxo_run(&ctx);
+	} else {
+		for (t = 0; t < num_t; ++t)
+			pthread_create(&thr[t], NULL, hxo_run, &ctx);
+		for (t = 0; t < num_t; ++t)
+			pthread_join(thr[t], NULL);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+	hxo_report(&ctx, (ts_end.tv_sec - ts_start.tv_sec) +
+		   (ts_end.tv_nsec - ts_start.tv_nsec) * 1e-9);
+
+	free(thr);
+	free(ctx.res);
+
+	return 0;
+}
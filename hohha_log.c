@@ -0,0 +1,587 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hohha_log.h"
+#include "hohha_util.h"
+
+/* records in a new index, doubled as it grows */
+#define HXL_IDX_CAP (1u << 10)
+
+static void hxl_put_le32(uint8_t *buf, uint32_t word)
+{
+	buf[0] = u8(word);
+	buf[1] = u8(word >> 8);
+	buf[2] = u8(word >> 16);
+	buf[3] = u8(word >> 24);
+}
+
+static void hxl_put_le64(uint8_t *buf, uint64_t word)
+{
+	hxl_put_le32(buf, u32(word));
+	hxl_put_le32(buf + 4, u32(word >> 32));
+}
+
+static uint64_t hxl_get_le64(uint8_t *buf)
+{
+	return leu32(buf) | ((uint64_t)leu32(buf + 4) << 32);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint64_t hxl_idx_get(struct hxl_log *log, uint64_t id)
+{
+	return hxl_get_le64(log->idx_map + HXL_HEAD_LEN + id * 8);
+}
+
+static void hxl_idx_set(struct hxl_log *log, uint64_t id, uint64_t off)
+{
+	hxl_put_le64(log->idx_map + HXL_HEAD_LEN + id * 8, off);
+}
+
+static size_t hxl_idx_len(size_t cap)
+{
+	return HXL_HEAD_LEN + cap * 8;
+}
+
+/* map the index, with room for at least cap records */
+static int hxl_idx_map(struct hxl_log *log, size_t cap)
+{
+	struct stat st;
+	uint8_t *map;
+
+	if (log->idx_map && cap <= log->idx_cap)
+		return 0;
+
+	/* never shrink the index, it may have more records than the map */
+	if (fstat(log->idx_fd, &st))
+		return -1;
+
+	if (st.st_size < hxl_idx_len(cap) &&
+	    ftruncate(log->idx_fd, hxl_idx_len(cap)))
+		return -1;
+
+	map = mmap(NULL, hxl_idx_len(cap), PROT_READ | PROT_WRITE,
+		   MAP_SHARED, log->idx_fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+
+	/* a sync may be using the old map */
+	pthread_mutex_lock(&log->sync_lock);
+
+	if (log->idx_map)
+		munmap(log->idx_map, hxl_idx_len(log->idx_cap));
+
+	log->idx_map = map;
+	log->idx_cap = cap;
+
+	pthread_mutex_unlock(&log->sync_lock);
+
+	return 0;
+}
+
+static int hxl_idx_add(struct hxl_log *log, uint64_t off)
+{
+	if (log->count == log->idx_cap &&
+	    hxl_idx_map(log, log->idx_cap << 1))
+		return -1;
+
+	/* publish the offset before the count, for hxl_sync() */
+	hxl_idx_set(log, log->count, off);
+	__atomic_store_n(&log->count, log->count + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static int hxl_pread(int fd, void *buf, size_t len, uint64_t off)
+{
+	ssize_t rc;
+
+	while (len) {
+		rc = pread(fd, buf, len, off);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return -1;
+
+		buf = (uint8_t *)buf + rc;
+		len -= rc;
+		off += rc;
+	}
+
+	return 0;
+}
+
+static int hxl_pwrite(int fd, const void *buf, size_t len, uint64_t off)
+{
+	ssize_t rc;
+
+	while (len) {
+		rc = pwrite(fd, buf, len, off);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return -1;
+
+		buf = (const uint8_t *)buf + rc;
+		len -= rc;
+		off += rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Read and decrypt the record at an offset, into a buffer that grows.
+ *
+ * Returns zero, one if the record is truncated or could not be read, or
+ * negative if the crc does not match.
+ */
+static int hxl_rec_read(struct hxl_log *log, struct hx_state *hx,
+			uint64_t off, uint64_t end, uint8_t **buf,
+			uint32_t *len)
+{
+	uint8_t head[HXL_REC_HEAD_LEN];
+
+	if (off + HXL_REC_HEAD_LEN > end ||
+	    hxl_pread(log->fd, head, HXL_REC_HEAD_LEN, off))
+		return 1;
+
+	*len = leu32(head + 8);
+	off += HXL_REC_HEAD_LEN;
+
+	if (off + *len > end)
+		return 1;
+
+	*buf = realloc(*buf, *len + 1);
+
+	if (hxl_pread(log->fd, *buf, *len, off))
+		return 1;
+
+	hx_copy(hx, log->hx);
+	hx_init_salt(hx, leu32(head), leu32(head + 4));
+	hx_decrypt(hx, *buf, *buf, *len);
+
+	if (hx_text_crc(hx) != leu32(head + 12))
+		return -1;
+
+	return 0;
+}
+
+static uint64_t hxl_rec_end(struct hxl_log *log, uint64_t off)
+{
+	uint8_t head[HXL_REC_HEAD_LEN];
+
+	if (hxl_pread(log->fd, head, HXL_REC_HEAD_LEN, off))
+		return 0;
+
+	return off + HXL_REC_HEAD_LEN + leu32(head + 8);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* sync the records from one id up to count, under sync_lock or in open */
+static int hxl_sync_range(struct hxl_log *log, uint64_t from, uint64_t count)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t start = hxl_idx_len(from) & ~(page - 1);
+
+	/* the records, then their offsets, then the count */
+	if (fdatasync(log->fd))
+		return -1;
+
+	if (msync(log->idx_map + start, hxl_idx_len(count) - start, MS_SYNC))
+		return -1;
+
+	hxl_put_le64(log->idx_map + 8, count);
+
+	if (msync(log->idx_map, HXL_HEAD_LEN, MS_SYNC))
+		return -1;
+
+	__atomic_store_n(&log->count_sync, count, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+static int hxl_recover(struct hxl_log *log, uint64_t size)
+{
+	struct hx_state *hx;
+	uint8_t *buf = NULL;
+	uint32_t len;
+	int rc = 0;
+
+	hx = malloc(hx_size(log->hx->key_mask + 1));
+
+	/* the count should be durable, but check the last record */
+	while (log->count) {
+		uint64_t off = hxl_idx_get(log, log->count - 1);
+
+		if (off >= HXL_HEAD_LEN && off < size &&
+		    !hxl_rec_read(log, hx, off, size, &buf, &len))
+			break;
+
+		--log->count;
+	}
+
+	log->end = HXL_HEAD_LEN;
+	if (log->count)
+		log->end = hxl_rec_end(log, hxl_idx_get(log, log->count - 1));
+
+	/* index the records appended, but not made durable */
+	while (!hxl_rec_read(log, hx, log->end, size, &buf, &len)) {
+		if (hxl_idx_add(log, log->end)) {
+			rc = -1;
+			goto out;
+		}
+
+		log->end += HXL_REC_HEAD_LEN + len;
+		++log->recover_count;
+	}
+
+	if (size > log->end) {
+		log->recover_trunc = size - log->end;
+		if (ftruncate(log->fd, log->end)) {
+			rc = -1;
+			goto out;
+		}
+	}
+
+	/* make the recovered count durable */
+	rc = hxl_sync_range(log, 0, log->count);
+out:
+	free(buf);
+	free(hx);
+
+	return rc;
+}
+
+int hxl_open(struct hxl_log *log, const char *path, struct hx_state *hx,
+	     uint32_t sync_every)
+{
+	uint8_t head[HXL_HEAD_LEN];
+	struct stat st;
+	char *idx_path;
+	uint64_t count;
+
+	memset(log, 0, sizeof(*log));
+	log->fd = -1;
+	log->idx_fd = -1;
+	log->sync_every = sync_every;
+
+	log->hx = malloc(hx_size(hx->key_mask + 1));
+	hx_copy(log->hx, hx);
+
+	pthread_rwlock_init(&log->lock, NULL);
+	pthread_mutex_init(&log->sync_lock, NULL);
+
+	log->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (log->fd < 0)
+		goto err;
+
+	idx_path = malloc(strlen(path) + 5);
+	sprintf(idx_path, "%s.idx", path);
+	log->idx_fd = open(idx_path, O_RDWR | O_CREAT, 0644);
+	free(idx_path);
+	if (log->idx_fd < 0)
+		goto err;
+
+	/* data file header */
+	if (fstat(log->fd, &st))
+		goto err;
+
+	if (st.st_size < HXL_HEAD_LEN) {
+		memset(head, 0, sizeof(head));
+		memcpy(head, HXL_MAGIC, 8);
+		hxl_put_le32(head + 8, HXL_VERSION);
+		if (ftruncate(log->fd, 0) ||
+		    hxl_pwrite(log->fd, head, HXL_HEAD_LEN, 0))
+			goto err;
+		st.st_size = HXL_HEAD_LEN;
+	} else {
+		if (hxl_pread(log->fd, head, HXL_HEAD_LEN, 0) ||
+		    memcmp(head, HXL_MAGIC, 8) ||
+		    leu32(head + 8) != HXL_VERSION)
+			goto err;
+	}
+
+	/* index file header, and count */
+	if (hxl_idx_map(log, HXL_IDX_CAP))
+		goto err;
+
+	count = 0;
+	if (!memcmp(log->idx_map, HXL_IDX_MAGIC, 8))
+		count = hxl_get_le64(log->idx_map + 8);
+	else
+		memcpy(log->idx_map, HXL_IDX_MAGIC, 8);
+
+	if (hxl_idx_map(log, count > HXL_IDX_CAP ? count : HXL_IDX_CAP))
+		goto err;
+
+	log->count = count;
+
+	if (hxl_recover(log, st.st_size))
+		goto err;
+
+	return 0;
+err:
+	hxl_close(log);
+	return -1;
+}
+
+void hxl_close(struct hxl_log *log)
+{
+	if (log->idx_map) {
+		hxl_sync(log);
+		munmap(log->idx_map, hxl_idx_len(log->idx_cap));
+	}
+
+	if (log->fd >= 0)
+		close(log->fd);
+	if (log->idx_fd >= 0)
+		close(log->idx_fd);
+
+	pthread_rwlock_destroy(&log->lock);
+	pthread_mutex_destroy(&log->sync_lock);
+	free(log->hx);
+
+	memset(log, 0, sizeof(*log));
+	log->fd = -1;
+	log->idx_fd = -1;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+int hxl_append(struct hxl_log *log, uint8_t *salt, uint8_t *data,
+	       uint32_t len, uint64_t *id)
+{
+	struct hx_state *hx;
+	uint8_t *rec;
+	int sync = 0;
+	int rc = 0;
+
+	rec = malloc(HXL_REC_HEAD_LEN + len);
+	hx = malloc(hx_size(log->hx->key_mask + 1));
+
+	if (salt)
+		memcpy(rec, salt, 8);
+	else if (getrandom(rec, 8, 0) != 8)
+		rc = -1;
+
+	/* encrypt before taking the lock */
+	if (!rc) {
+		hx_copy(hx, log->hx);
+		hx_init_salt(hx, leu32(rec), leu32(rec + 4));
+		hx_encrypt(hx, data, rec + HXL_REC_HEAD_LEN, len);
+		hxl_put_le32(rec + 8, len);
+		hxl_put_le32(rec + 12, hx_text_crc(hx));
+	}
+
+	pthread_rwlock_wrlock(&log->lock);
+
+	if (!rc)
+		rc = hxl_pwrite(log->fd, rec, HXL_REC_HEAD_LEN + len,
+				log->end);
+
+	if (!rc)
+		rc = hxl_idx_add(log, log->end);
+
+	if (!rc) {
+		if (id)
+			*id = log->count - 1;
+
+		log->end += HXL_REC_HEAD_LEN + len;
+
+		sync = log->sync_every && log->count -
+			__atomic_load_n(&log->count_sync, __ATOMIC_RELAXED) >=
+			log->sync_every;
+	}
+
+	pthread_rwlock_unlock(&log->lock);
+
+	/* sync outside the lock, so readers only wait to publish the index */
+	if (sync)
+		rc = hxl_sync(log);
+
+	free(hx);
+	free(rec);
+
+	return rc;
+}
+
+int hxl_sync(struct hxl_log *log)
+{
+	uint64_t count;
+	int rc = 0;
+
+	pthread_mutex_lock(&log->sync_lock);
+
+	/* records appended meanwhile are left for the next sync */
+	count = __atomic_load_n(&log->count, __ATOMIC_ACQUIRE);
+	if (count != log->count_sync)
+		rc = hxl_sync_range(log, log->count_sync, count);
+
+	pthread_mutex_unlock(&log->sync_lock);
+
+	return rc;
+}
+
+uint64_t hxl_count(struct hxl_log *log)
+{
+	uint64_t count;
+
+	pthread_rwlock_rdlock(&log->lock);
+	count = log->count;
+	pthread_rwlock_unlock(&log->lock);
+
+	return count;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+int hxl_read(struct hxl_log *log, uint64_t id, uint8_t **data,
+	     uint32_t *len)
+{
+	struct hx_state *hx;
+	uint64_t off, end;
+	int rc;
+
+	*data = NULL;
+	*len = 0;
+
+	/* records are never changed, only the index is locked */
+	pthread_rwlock_rdlock(&log->lock);
+	if (id >= log->count) {
+		pthread_rwlock_unlock(&log->lock);
+		return 1;
+	}
+	off = hxl_idx_get(log, id);
+	end = log->end;
+	pthread_rwlock_unlock(&log->lock);
+
+	hx = malloc(hx_size(log->hx->key_mask + 1));
+	rc = hxl_rec_read(log, hx, off, end, data, len);
+	free(hx);
+
+	if (rc) {
+		free(*data);
+		*data = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* records read by each thread at a time */
+#define HXL_SCAN_CHUNK 256
+
+struct hxl_scan {
+	struct hxl_log *log;
+	hxl_scan_fn fn;
+	void *arg;
+	uint64_t count;			/* records to scan */
+	uint64_t end;			/* end of records to scan */
+	uint64_t next;			/* next chunk of records */
+	int64_t bad;			/* records with bad crc */
+	int stop;			/* stopped by callback or error */
+	int err;			/* a record could not be read */
+};
+
+static void *hxl_scan_run(void *arg)
+{
+	struct hxl_scan *scan = arg;
+	struct hxl_log *log = scan->log;
+	uint64_t off[HXL_SCAN_CHUNK];
+	uint64_t first, i, n;
+	struct hx_state *hx;
+	uint8_t *buf = NULL;
+	uint32_t len;
+	int rc;
+
+	hx = malloc(hx_size(log->hx->key_mask + 1));
+
+	while (!__atomic_load_n(&scan->stop, __ATOMIC_RELAXED)) {
+		first = __atomic_fetch_add(&scan->next, HXL_SCAN_CHUNK,
+					   __ATOMIC_RELAXED);
+		if (first >= scan->count)
+			break;
+
+		n = scan->count - first;
+		if (n > HXL_SCAN_CHUNK)
+			n = HXL_SCAN_CHUNK;
+
+		pthread_rwlock_rdlock(&log->lock);
+		for (i = 0; i < n; ++i)
+			off[i] = hxl_idx_get(log, first + i);
+		pthread_rwlock_unlock(&log->lock);
+
+		for (i = 0; i < n; ++i) {
+			rc = hxl_rec_read(log, hx, off[i], scan->end,
+					  &buf, &len);
+			if (rc > 0) {
+				scan->err = 1;
+				__atomic_store_n(&scan->stop, 1,
+						 __ATOMIC_RELAXED);
+				break;
+			}
+
+			if (rc)
+				__atomic_fetch_add(&scan->bad, 1,
+						   __ATOMIC_RELAXED);
+
+			if (scan->fn(first + i, rc ? NULL : buf, len,
+				     scan->arg)) {
+				__atomic_store_n(&scan->stop, 1,
+						 __ATOMIC_RELAXED);
+				break;
+			}
+		}
+	}
+
+	free(buf);
+	free(hx);
+
+	return NULL;
+}
+
+int64_t hxl_scan(struct hxl_log *log, uint32_t threads, hxl_scan_fn fn,
+		 void *arg)
+{
+	struct hxl_scan scan;
+	pthread_t *thr;
+	uint32_t t;
+
+	memset(&scan, 0, sizeof(scan));
+	scan.log = log;
+	scan.fn = fn;
+	scan.arg = arg;
+
+	pthread_rwlock_rdlock(&log->lock);
+	scan.count = log->count;
+	scan.end = log->end;
+	pthread_rwlock_unlock(&log->lock);
+
+	if (threads <= 1) {
+		hxl_scan_run(&scan);
+	} else {
+		thr = calloc(threads, sizeof(*thr));
+
+		for (t = 0; t < threads; ++t)
+			pthread_create(&thr[t], NULL, hxl_scan_run, &scan);
+		for (t = 0; t < threads; ++t)
+			pthread_join(thr[t], NULL);
+
+		free(thr);
+	}
+
+	if (scan.err)
+		return -1;
+
+	return scan.bad;
+}
@@ -0,0 +1,144 @@
+#ifndef HOHHA_LOG_H
+#define HOHHA_LOG_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "hohha_xor.h"
+
+/*
+ * Append-only log of encrypted records, with an index of record offsets.
+ *
+ * The log is two files: the data file, and the index file (path ".idx").
+ * All numbers are in little endian.  The data file is a header of 16 bytes,
+ * HXL_MAGIC and HXL_VERSION (uint32_t) and zeros, followed by records.  Each
+ * record is a header of 16 bytes, followed by the cipher text:
+ *
+ *   uint8_t salt[8];		salt of the record
+ *   uint32_t len;		length of the cipher text
+ *   uint32_t crc;		hx_text_crc of the plain text
+ *
+ * The index file is a header of 16 bytes, HXL_IDX_MAGIC and the count of
+ * records (uint64_t), followed by the offset of each record in the data
+ * file (uint64_t).  The index is mapped in memory, so a record is found in
+ * constant time.
+ *
+ * Appends are written immediately, but only made durable by hxl_sync(),
+ * every so many appends.  Then the data file is synced before the count of
+ * records in the index.  A sync does not block readers or appends, except
+ * an append that grows the index.  When the log is opened, records past the count
+ * are checked and indexed, until the first record that is truncated or
+ * whose crc does not match, and the data file is truncated there.
+ */
+
+#define HXL_MAGIC "HOHHALOG"
+#define HXL_IDX_MAGIC "HOHHAIDX"
+#define HXL_VERSION 1
+
+#define HXL_HEAD_LEN 16
+#define HXL_REC_HEAD_LEN 16
+
+struct hxl_log {
+	int fd;				/* data file */
+	int idx_fd;			/* index file */
+	uint8_t *idx_map;		/* mapped index file */
+	size_t idx_cap;			/* records that fit in the map */
+	uint64_t count;			/* records appended */
+	uint64_t count_sync;		/* records made durable */
+	uint64_t end;			/* offset of the next record */
+	uint32_t sync_every;		/* appends per sync, or zero */
+	struct hx_state *hx;		/* key of every record */
+	pthread_rwlock_t lock;		/* appends exclude readers */
+	pthread_mutex_t sync_lock;	/* syncs exclude syncs and remaps */
+
+	uint64_t recover_count;		/* records found past the count */
+	uint64_t recover_trunc;		/* bytes truncated at the end */
+};
+
+/**
+ * Scan callback, for each record.
+ *
+ * Returns zero to continue, or nonzero to stop the scan.
+ *
+ * @id - record id
+ * @data - plain text, or NULL if the crc does not match
+ * @len - length of the plain text
+ * @arg - argument of the scan
+ */
+typedef int (*hxl_scan_fn)(uint64_t id, uint8_t *data, uint32_t len,
+			   void *arg);
+
+/**
+ * Open or create a log, and recover it after a crash.
+ *
+ * Returns zero, or nonzero if the log could not be opened.
+ *
+ * @log - log to initialize
+ * @path - path of the data file
+ * @hx - initialized key of the records, the salt does not matter
+ * @sync_every - appends before each sync, or zero to sync only explicitly
+ */
+int hxl_open(struct hxl_log *log, const char *path, struct hx_state *hx,
+	     uint32_t sync_every);
+
+/**
+ * Sync and close a log.
+ */
+void hxl_close(struct hxl_log *log);
+
+/**
+ * Encrypt and append a record.
+ *
+ * Returns zero, or nonzero if the record could not be written.
+ *
+ * @log - log to append
+ * @salt - eight bytes of salt, or NULL for random salt
+ * @data - plain text of the record
+ * @len - length of the plain text
+ * @id - set to the id of the record, or NULL
+ */
+int hxl_append(struct hxl_log *log, uint8_t *salt, uint8_t *data,
+	       uint32_t len, uint64_t *id);
+
+/**
+ * Make the appended records durable.
+ *
+ * Returns zero, or nonzero if the files could not be synced.
+ */
+int hxl_sync(struct hxl_log *log);
+
+/**
+ * Number of records in the log.
+ */
+uint64_t hxl_count(struct hxl_log *log);
+
+/**
+ * Read and decrypt one record.
+ *
+ * Returns zero, one if there is no such record, or negative if the record
+ * could not be read or its crc does not match.
+ *
+ * @log - log to read
+ * @id - record id
+ * @data - set to the plain text, to be freed by the caller
+ * @len - set to the length of the plain text
+ */
+int hxl_read(struct hxl_log *log, uint64_t id, uint8_t **data,
+	     uint32_t *len);
+
+/**
+ * Read and decrypt every record, in parallel.
+ *
+ * The records are divided among threads, so the callback is called
+ * concurrently, and not in order of id.  Returns the number of records
+ * whose crc does not match, or negative if a record could not be read.
+ *
+ * @log - log to read
+ * @threads - number of threads
+ * @fn - callback for each record
+ * @arg - argument of the callback
+ */
+int64_t hxl_scan(struct hxl_log *log, uint32_t threads, hxl_scan_fn fn,
+		 void *arg);
+
+#endif
@@ -0,0 +1,336 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_log.h"
+
+/*
+ * Append, read, and scan an encrypted record log.
+ *
+ * See hohha_log.h for the format of the log.
+ */
+
+struct hxl_print {
+	pthread_mutex_t lock;		/* one record per line */
+	int opt_D;			/* plain text instead of base64 */
+	char *data;			/* base64 of one record */
+	size_t data_len;		/* length of the base64 buffer */
+	uint64_t bytes;			/* bytes of plain text */
+};
+
+static void hxl_print_rec(struct hxl_print *p, uint64_t id, uint8_t *data,
+			  uint32_t len)
+{
+	size_t data_len;
+
+	if (!data) {
+		printf("%" PRIu64 ": crc mismatch\n", id);
+		return;
+	}
+
+	if (p->opt_D) {
+		printf("%" PRIu64 ": ", id);
+		fwrite(data, 1, len, stdout);
+		putchar('\n');
+		return;
+	}
+
+	data_len = ((size_t)len * 4 / 3 + 3) & ~3;
+	if (p->data_len < data_len + 1) {
+		p->data_len = data_len + 1;
+		p->data = realloc(p->data, p->data_len);
+	}
+
+	b64_encode(data, len, p->data, data_len + 1);
+	printf("%" PRIu64 ": %s\n", id, p->data);
+}
+
+static int hxl_print_scan(uint64_t id, uint8_t *data, uint32_t len, void *arg)
+{
+	struct hxl_print *p = arg;
+
+	pthread_mutex_lock(&p->lock);
+	hxl_print_rec(p, id, data, len);
+	p->bytes += len;
+	pthread_mutex_unlock(&p->lock);
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+int main(int argc, char **argv)
+{
+	struct hxl_log log;
+	struct hxl_print p;
+	struct hx_state *hx;
+	struct timespec ts_start, ts_end;
+	double secs;
+
+	int rc, errflg = 0;
+
+	char *arg_K = NULL;
+	char *arg_f = NULL;
+	char *arg_g = NULL;
+	char *arg_t = NULL;
+	char *arg_S = NULL;
+
+	int opt_a = 0;
+	int opt_s = 0;
+	int opt_n = 0;
+
+	uint8_t *raw_K = NULL;
+	size_t raw_K_len = 0;
+	uint32_t num_j, num_l;
+
+	uint32_t num_t = 1;
+	uint32_t num_S = 64;
+	uint64_t num_g = 0;
+
+	char *line = NULL;
+	size_t line_cap = 0;
+	ssize_t line_len;
+	uint64_t id, count = 0;
+	uint8_t *data;
+	uint32_t len;
+	int64_t bad;
+
+	memset(&p, 0, sizeof(p));
+	pthread_mutex_init(&p.lock, NULL);
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "K:f:ag:snDt:S:v")) != -1) {
+		switch (rc) {
+		case 'K': /* key: base64 (hohha format) */
+			arg_K = optarg;
+			break;
+		case 'f': /* log file: string */
+			arg_f = optarg;
+			break;
+
+		case 'a': /* append each line of stdin */
+			opt_a = 1;
+			break;
+		case 'g': /* get one record: numeric */
+			arg_g = optarg;
+			break;
+		case 's': /* scan every record */
+			opt_s = 1;
+			break;
+		case 'n': /* count records */
+			opt_n = 1;
+			break;
+
+		case 'D': /* print plain text, not base64 */
+			p.opt_D = 1;
+			break;
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+		case 'S': /* appends per sync: numeric */
+			arg_S = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_K || !arg_f) {
+		fprintf(stderr, "missing one of the required options\n");
+		++errflg;
+	}
+
+	if (opt_a + !!arg_g + opt_s + opt_n != 1) {
+		fprintf(stderr, "specify exactly one of -a, -g, -s, or -n\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s -K <key> -f <file> <operation> <options> [-v]\n"
+			"\n"
+			"  Log:\n"
+			"    -K <key>\n"
+			"      Key of the records, hohha key format (base64) (required)\n"
+			"    -f <file>\n"
+			"      Log data file, index is <file>.idx (required)\n"
+			"\n"
+			"  Operation:\n"
+			"    -a\n"
+			"      Append each line of stdin as a record\n"
+			"    -g <id>\n"
+			"      Get one record\n"
+			"    -s\n"
+			"      Scan every record, in parallel, not in order\n"
+			"    -n\n"
+			"      Print the number of records\n"
+			"\n"
+			"  Options:\n"
+			"    -D\n"
+			"      Print plain text, instead of base64\n"
+			"    -t <threads>\n"
+			"      Number of threads for -s (default: 1)\n"
+			"    -S <appends>\n"
+			"      Appends per sync, zero to sync at exit (default: 64)\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	rc = b64_decode(arg_K, strlen(arg_K), NULL, &raw_K_len);
+	if (rc || raw_K_len < 11) {
+		fprintf(stderr, "invalid -K '%s'\n", arg_K);
+		exit(1);
+	}
+
+	raw_K = malloc(raw_K_len);
+	b64_decode(arg_K, strlen(arg_K), raw_K, &raw_K_len);
+
+	/* hohha key format: jumps, length, salt, body */
+	num_j = raw_K[0];
+	num_l = raw_K[1] | (raw_K[2] << 8);
+	if (!num_l || !is_pow2(num_l) || raw_K_len - 11 < num_l) {
+		fprintf(stderr, "invalid -K '%s'\n", arg_K);
+		exit(1);
+	}
+
+	if (arg_g) {
+		char *end;
+
+		errno = 0;
+		num_g = strtoull(arg_g, &end, 0);
+		if (errno || end == arg_g || *end) {
+			fprintf(stderr, "invalid -g '%s'\n", arg_g);
+			exit(1);
+		}
+	}
+
+	if (arg_t) {
+		unsigned long val;
+
+		errno = 0;
+		val = strtoul(arg_t, NULL, 0);
+		if (errno || !val || val > 1024) {
+			fprintf(stderr, "invalid -t '%s'\n", arg_t);
+			exit(1);
+		}
+
+		num_t = (uint32_t)val;
+	}
+
+	if (arg_S) {
+		unsigned long val;
+
+		errno = 0;
+		val = strtoul(arg_S, NULL, 0);
+		if (errno || val > UINT32_MAX) {
+			fprintf(stderr, "invalid -S '%s'\n", arg_S);
+			exit(1);
+		}
+
+		num_S = (uint32_t)val;
+	}
+
+	hx = malloc(hx_size(num_l));
+	hx_init(hx, raw_K + 11, num_l, num_j, 0, 0, 0);
+
+	if (hxl_open(&log, arg_f, hx, num_S)) {
+		fprintf(stderr, "invalid -f '%s': %s\n", arg_f, strerror(errno));
+		exit(1);
+	}
+
+	dbg("records: %" PRIu64 " recovered: %" PRIu64
+	    " truncated: %" PRIu64 " bytes\n",
+	    log.count, log.recover_count, log.recover_trunc);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	rc = 0;
+
+	if (opt_a) {
+		while ((line_len = getline(&line, &line_cap, stdin)) > 0) {
+			if (line[line_len - 1] == '\n')
+				--line_len;
+
+			rc = hxl_append(&log, NULL, (uint8_t *)line,
+					line_len, &id);
+			if (rc) {
+				fprintf(stderr, "append failed\n");
+				break;
+			}
+
+			vdbg("%" PRIu64 ": %zd bytes\n", id, line_len);
+			++count;
+		}
+
+		if (!rc && hxl_sync(&log)) {
+			fprintf(stderr, "sync failed\n");
+			rc = 1;
+		}
+	}
+
+	if (arg_g) {
+		rc = hxl_read(&log, num_g, &data, &len);
+		if (rc > 0) {
+			fprintf(stderr, "no record %" PRIu64 "\n", num_g);
+		} else if (rc) {
+			fprintf(stderr, "invalid record %" PRIu64 "\n", num_g);
+		} else {
+			hxl_print_rec(&p, num_g, data, len);
+			free(data);
+			count = 1;
+		}
+	}
+
+	if (opt_s) {
+		bad = hxl_scan(&log, num_t, hxl_print_scan, &p);
+		if (bad < 0) {
+			fprintf(stderr, "scan failed\n");
+			rc = 1;
+		} else if (bad) {
+			fprintf(stderr, "crc mismatch: %" PRId64 " records\n",
+				bad);
+			rc = 1;
+		}
+		count = hxl_count(&log);
+	}
+
+	if (opt_n)
+		printf("%" PRIu64 "\n", hxl_count(&log));
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	secs = (ts_end.tv_sec - ts_start.tv_sec) +
+		(ts_end.tv_nsec - ts_start.tv_nsec) * 1e-9;
+
+	dbg("records: %" PRIu64 " in %.3fs\n", count, secs);
+
+	hxl_close(&log);
+
+	free(line);
+	free(p.data);
+	free(hx);
+	free(raw_K);
+
+	return !!rc;
+}
@@ -0,0 +1,304 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+
+/*
+ * Recover a message (CPA2), or forge a cipher text (CCA2), with a local oracle.
+ *
+ * This runs the attack of attacks/solve-msg.py, but the oracle is an
+ * hx_state in the same process, instead of a script.  See attacks/README.md
+ * for how the attack works.
+ *
+ * The parity of each byte depends only on the key, the salt, and the plain
+ * text before it.  Instead of encrypting the whole prefix again for each
+ * byte, the oracle keeps a snapshot of the state after the known prefix,
+ * and each query extends it by one byte.  That is linear in the length of
+ * the message, instead of quadratic.
+ */
+
+typedef void (*hxm_crypt_fn)(struct hx_state *hx, uint8_t *in_buf,
+			     uint8_t *out_buf, uint32_t len);
+
+struct hxm_oracle {
+	hxm_crypt_fn fn;		/* encrypt or decrypt */
+	struct hx_state *hx;		/* state of each query */
+	struct hx_state *hx_orig;	/* state before any text */
+	uint8_t *snap;			/* state after the known prefix */
+	size_t snap_len;		/* length of the snapshot */
+	uint8_t *buf;			/* whole prefix of each query */
+	uint8_t *out;			/* whole output of each query */
+	uint64_t queries;		/* number of queries */
+	uint64_t bytes;			/* bytes given to the oracle */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* query one byte, following the prefix of the snapshot */
+static uint8_t hxm_query_next(struct hxm_oracle *o, uint8_t in)
+{
+	uint8_t out;
+
+	hx_snap_load(o->hx, o->snap, o->snap_len);
+	o->fn(o->hx, &in, &out, 1);
+
+	++o->queries;
+	++o->bytes;
+
+	return out;
+}
+
+/* extend the prefix of the snapshot by one byte */
+static void hxm_extend(struct hxm_oracle *o, uint8_t in)
+{
+	uint8_t out;
+
+	hx_snap_load(o->hx, o->snap, o->snap_len);
+	o->fn(o->hx, &in, &out, 1);
+	hx_snap_save(o->hx, o->snap);
+}
+
+/* query the whole prefix again, like solve-msg.py */
+static uint8_t hxm_query_prefix(struct hxm_oracle *o, uint8_t *prefix,
+				uint32_t len, uint8_t in)
+{
+	memcpy(o->buf, prefix, len);
+	o->buf[len] = in;
+
+	hx_copy(o->hx, o->hx_orig);
+	o->fn(o->hx, o->buf, o->out, len + 1);
+
+	++o->queries;
+	o->bytes += len + 1;
+
+	return o->out[len];
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+int main(int argc, char **argv)
+{
+	struct hxm_oracle o;
+	struct timespec ts_start, ts_end;
+	double secs;
+
+	int rc, errflg = 0;
+
+	char *arg_K = NULL;
+	char *arg_S = NULL;
+	char *arg_m = NULL;
+	char *arg_M = NULL;
+
+	int opt_d = 0;
+	int opt_Q = 0;
+
+	uint8_t *raw_K = NULL;
+	size_t raw_K_len = 0;
+	uint32_t num_j, num_l;
+
+	uint8_t raw_S[8];
+
+	uint8_t *raw_m = NULL;
+	size_t raw_m_len = 0;
+
+	uint8_t *res;
+	char *data;
+	size_t data_len, i;
+
+	memset(&o, 0, sizeof(o));
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "K:S:m:M:dQv")) != -1) {
+		switch (rc) {
+		case 'K': /* secret key of the oracle: base64 */
+			arg_K = optarg;
+			break;
+		case 'S': /* salt: eight numeric bytes */
+			arg_S = optarg;
+			break;
+
+		case 'm': /* target message: base64 */
+			arg_m = optarg;
+			break;
+		case 'M': /* target message: string */
+			arg_M = optarg;
+			break;
+
+		case 'd': /* decryption oracle: forge cipher text */
+			opt_d = 1;
+			break;
+		case 'Q': /* query the whole prefix each time */
+			opt_Q = 1;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_K) {
+		fprintf(stderr, "missing -K for the oracle\n");
+		++errflg;
+	}
+
+	if (!arg_m == !arg_M) {
+		fprintf(stderr, "specify exactly one of -m or -M\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s -K <key> [-S <salt>] <message> [-d] [-Q] [-v]\n"
+			"\n"
+			"  Recover the plain text of a cipher text, with an\n"
+			"  encryption oracle (CPA2), or forge the cipher text of\n"
+			"  a plain text, with a decryption oracle (CCA2).\n"
+			"\n"
+			"  Oracle:\n"
+			"    -K <key>\n"
+			"      Secret key of the oracle (base64)\n"
+			"    -S <salt>\n"
+			"      Salt, eight numeric bytes (default: key salt)\n"
+			"    -d\n"
+			"      Decryption oracle: forge a cipher text\n"
+			"\n"
+			"  Message:\n"
+			"    -m <message>\n"
+			"      Target message (base64)\n"
+			"    -M <message>\n"
+			"      Target message (string)\n"
+			"\n"
+			"  Options:\n"
+			"    -Q\n"
+			"      Query the whole prefix for each byte, like solve-msg.py\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	rc = b64_decode(arg_K, strlen(arg_K), NULL, &raw_K_len);
+	if (rc || raw_K_len < 11) {
+		fprintf(stderr, "invalid -K '%s'\n", arg_K);
+		exit(1);
+	}
+
+	raw_K = malloc(raw_K_len);
+	b64_decode(arg_K, strlen(arg_K), raw_K, &raw_K_len);
+
+	/* hohha key format: jumps, length, salt, body */
+	num_j = raw_K[0];
+	num_l = raw_K[1] | (raw_K[2] << 8);
+	if (!num_l || !is_pow2(num_l) || raw_K_len - 11 < num_l) {
+		fprintf(stderr, "invalid -K '%s'\n", arg_K);
+		exit(1);
+	}
+
+	if (arg_S) {
+		rc = sscanf(arg_S, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu\n",
+			    &raw_S[0], &raw_S[1], &raw_S[2], &raw_S[3],
+			    &raw_S[4], &raw_S[5], &raw_S[6], &raw_S[7]);
+		if (rc != 8) {
+			fprintf(stderr, "invalid -S '%s'\n", arg_S);
+			exit(1);
+		}
+	} else {
+		memcpy(raw_S, raw_K + 3, 8);
+	}
+
+	if (arg_m) {
+		rc = b64_decode(arg_m, strlen(arg_m), NULL, &raw_m_len);
+		if (rc) {
+			fprintf(stderr, "invalid -m '%s'\n", arg_m);
+			exit(1);
+		}
+
+		raw_m = malloc(raw_m_len + 1);
+		b64_decode(arg_m, strlen(arg_m), raw_m, &raw_m_len);
+	} else {
+		raw_m_len = strlen(arg_M);
+		raw_m = malloc(raw_m_len + 1);
+		memcpy(raw_m, arg_M, raw_m_len);
+	}
+
+	if (raw_m_len > UINT32_MAX) {
+		fprintf(stderr, "message too long\n");
+		exit(1);
+	}
+
+	o.fn = opt_d ? hx_decrypt : hx_encrypt;
+	o.hx = malloc(hx_size(num_l));
+	o.hx_orig = malloc(hx_size(num_l));
+
+	hx_init(o.hx_orig, raw_K + 11, num_l, num_j,
+		leu32(raw_S), leu32(raw_S + 4), 0);
+
+	o.snap = malloc(hx_snap_len(o.hx_orig));
+	o.snap_len = hx_snap_save(o.hx_orig, o.snap);
+
+	if (opt_Q) {
+		o.buf = malloc(raw_m_len + 1);
+		o.out = malloc(raw_m_len + 1);
+	}
+
+	res = malloc(raw_m_len + 1);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	/*
+	 * With zero as the next byte, the oracle reveals the parity.  For
+	 * recovery, the parity and cipher text reveal the plain text.  For
+	 * forgery, the parity and plain text produce the cipher text.
+	 */
+	for (i = 0; i < raw_m_len; ++i) {
+		if (opt_Q) {
+			res[i] = raw_m[i] ^ hxm_query_prefix(&o, res, i, 0);
+		} else {
+			res[i] = raw_m[i] ^ hxm_query_next(&o, 0);
+			hxm_extend(&o, res[i]);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	secs = (ts_end.tv_sec - ts_start.tv_sec) +
+		(ts_end.tv_nsec - ts_start.tv_nsec) * 1e-9;
+
+	dbg("queries: %" PRIu64 " bytes: %" PRIu64 " in %.6fs\n",
+	    o.queries, o.bytes, secs);
+
+	data_len = (raw_m_len * 4 / 3 + 3) & ~3;
+	data = malloc(data_len + 1);
+
+	b64_encode(res, raw_m_len, data, data_len + 1);
+	printf("%s\n", data);
+
+	free(data);
+	free(res);
+	free(o.buf);
+	free(o.out);
+	free(o.snap);
+	free(o.hx);
+	free(o.hx_orig);
+	free(raw_m);
+	free(raw_K);
+
+	return 0;
+}
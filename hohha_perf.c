@@ -0,0 +1,160 @@
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "hohha_perf.h"
+#include "hohha_util.h"
+
+struct hxp_attr {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+};
+
+static const struct hxp_attr hxp_attrs[HXP_EVENTS] = {
+	[HXP_CYCLES] = { "cycles", PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_CPU_CYCLES },
+	[HXP_INSTR] = { "instr", PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_INSTRUCTIONS },
+	[HXP_BRANCH_MISS] = { "br_miss", PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_BRANCH_MISSES },
+	[HXP_L1D_MISS] = { "l1d_miss", PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+	[HXP_LLC_MISS] = { "llc_miss", PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_CACHE_MISSES },
+};
+
+/* value, scaled if the counter was multiplexed */
+static uint64_t hxp_read(int fd)
+{
+	uint64_t buf[3]; /* value, time enabled, time running */
+
+	if (read(fd, buf, sizeof(buf)) != sizeof(buf) || !buf[2])
+		return 0;
+
+	if (buf[1] == buf[2])
+		return buf[0];
+
+	return (uint64_t)((double)buf[0] * buf[1] / buf[2]);
+}
+
+int hxp_open(struct hxp_ctr *ctr)
+{
+	struct perf_event_attr attr;
+	int i, count = 0;
+
+	memset(ctr, 0, sizeof(*ctr));
+
+	for (i = 0; i < HXP_EVENTS; ++i) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = hxp_attrs[i].type;
+		attr.config = hxp_attrs[i].config;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		/* this thread, on any cpu */
+		ctr->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		if (ctr->fd[i] < 0) {
+			vdbg("perf counter %s: %s\n", hxp_attrs[i].name,
+			     strerror(errno));
+			continue;
+		}
+
+		ctr->have |= 1u << i;
+		++count;
+	}
+
+	return count;
+}
+
+void hxp_close(struct hxp_ctr *ctr)
+{
+	int i;
+
+	for (i = 0; i < HXP_EVENTS; ++i)
+		if (ctr->have & (1u << i))
+			close(ctr->fd[i]);
+
+	ctr->have = 0;
+}
+
+void hxp_begin(struct hxp_ctr *ctr, struct hxp_sample *sample)
+{
+	int i;
+
+	for (i = 0; i < HXP_EVENTS; ++i)
+		if (ctr->have & (1u << i))
+			sample->start[i] = hxp_read(ctr->fd[i]);
+}
+
+void hxp_end(struct hxp_ctr *ctr, struct hxp_sample *sample)
+{
+	uint64_t end;
+	int i;
+
+	for (i = 0; i < HXP_EVENTS; ++i) {
+		if (!(ctr->have & (1u << i)))
+			continue;
+
+		end = hxp_read(ctr->fd[i]);
+		if (end > sample->start[i])
+			sample->val[i] += end - sample->start[i];
+	}
+
+	sample->have |= ctr->have;
+	++sample->regions;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+const char *hxp_name(enum hxp_event event)
+{
+	return hxp_attrs[event].name;
+}
+
+double hxp_per(struct hxp_sample *sample, enum hxp_event event, uint64_t per)
+{
+	if (!(sample->have & (1u << event)) || !per)
+		return -1;
+
+	return (double)sample->val[event] / per;
+}
+
+double hxp_ipc(struct hxp_sample *sample)
+{
+	if ((~sample->have & ((1u << HXP_CYCLES) | (1u << HXP_INSTR))) ||
+	    !sample->val[HXP_CYCLES])
+		return -1;
+
+	return (double)sample->val[HXP_INSTR] / sample->val[HXP_CYCLES];
+}
+
+void hxp_show(FILE *f, const char *name, struct hxp_sample *sample,
+	      uint64_t per, const char *unit)
+{
+	int i;
+
+	fprintf(f, "%s:", name);
+
+	if (!sample->have) {
+		fprintf(f, " counters not available\n");
+		return;
+	}
+
+	if (hxp_ipc(sample) >= 0)
+		fprintf(f, " ipc %.2f", hxp_ipc(sample));
+
+	for (i = 0; i < HXP_EVENTS; ++i)
+		if (hxp_per(sample, i, per) >= 0)
+			fprintf(f, " %s/%s %.3f", hxp_attrs[i].name, unit,
+				hxp_per(sample, i, per));
+
+	fprintf(f, "\n");
+}
@@ -0,0 +1,91 @@
+#ifndef HOHHA_PERF_H
+#define HOHHA_PERF_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Hardware performance counters of the calling thread, by perf_event_open.
+ *
+ * Each counter is opened on its own, for user space only, so that any
+ * counter the kernel or hardware does not permit is just missing.  If no
+ * counter is permitted, as with a high perf_event_paranoid or in a
+ * container, regions are still marked, but nothing is counted.
+ *
+ * A region is marked by hxp_begin() and hxp_end(), which add what was
+ * counted in between to a sample.  Regions of different samples may nest.
+ * Each mark reads every counter with a system call, so mark regions that
+ * are much longer than that, or only some of them.
+ */
+
+enum hxp_event {
+	HXP_CYCLES,			/* cpu cycles */
+	HXP_INSTR,			/* instructions retired */
+	HXP_BRANCH_MISS,		/* mispredicted branches */
+	HXP_L1D_MISS,			/* level 1 data cache read misses */
+	HXP_LLC_MISS,			/* last level cache misses */
+	HXP_EVENTS,
+};
+
+struct hxp_ctr {
+	int fd[HXP_EVENTS];		/* counter, or negative */
+	uint32_t have;			/* mask of counters opened */
+};
+
+struct hxp_sample {
+	uint32_t have;			/* mask of counters counted */
+	uint64_t regions;		/* regions added */
+	uint64_t val[HXP_EVENTS];	/* total of each counter */
+	uint64_t start[HXP_EVENTS];	/* values at the begin mark */
+};
+
+/**
+ * Open the counters of the calling thread.
+ *
+ * Returns the number of counters opened, or zero if none are permitted.
+ */
+int hxp_open(struct hxp_ctr *ctr);
+
+/**
+ * Close the counters.
+ */
+void hxp_close(struct hxp_ctr *ctr);
+
+/**
+ * Mark the beginning of a region of a sample.
+ */
+void hxp_begin(struct hxp_ctr *ctr, struct hxp_sample *sample);
+
+/**
+ * Mark the end of a region, and add its counts to a sample.
+ */
+void hxp_end(struct hxp_ctr *ctr, struct hxp_sample *sample);
+
+/**
+ * Print a sample: IPC, and each counter per unit of work.
+ *
+ * @f - output file
+ * @name - name of the region
+ * @sample - counts of the region
+ * @per - units of work, like bytes or nodes
+ * @unit - name of the unit
+ */
+void hxp_show(FILE *f, const char *name, struct hxp_sample *sample,
+	      uint64_t per, const char *unit);
+
+/**
+ * Value of a counter per unit of work, or negative if not counted.
+ */
+double hxp_per(struct hxp_sample *sample, enum hxp_event event, uint64_t per);
+
+/**
+ * Instructions per cycle, or negative if not counted.
+ */
+double hxp_ipc(struct hxp_sample *sample);
+
+/**
+ * Short name of a counter.
+ */
+const char *hxp_name(enum hxp_event event);
+
+#endif
@@ -0,0 +1,292 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_kpa.h"
+
+/*
+ * Rotate the key of a corpus, by transcrypting each cipher text.
+ *
+ * Each record keeps its salt, and its cipher text is decrypted with the old
+ * key and encrypted with the new key in one pass, by hx_transcrypt.  The
+ * records are divided among threads, and transcrypted in place.
+ */
+
+struct hxr_ctx {
+	struct hxk_kpa kpa;		/* corpus to transcrypt */
+	struct hx_state *hx_dec;	/* old key */
+	struct hx_state *hx_enc;	/* new key */
+};
+
+struct hxr_job {
+	struct hxr_ctx *ctx;
+	size_t first;			/* index of first record */
+	size_t count;			/* number of records */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void *hxr_job_run(void *arg)
+{
+	struct hxr_job *job = arg;
+	struct hxr_ctx *ctx = job->ctx;
+	struct hx_state *dec, *enc;
+	struct hxk_pair *pair;
+	size_t i;
+
+	dec = malloc(hx_size(ctx->hx_dec->key_mask + 1));
+	enc = malloc(hx_size(ctx->hx_enc->key_mask + 1));
+
+	for (i = job->first; i < job->first + job->count; ++i) {
+		pair = &ctx->kpa.pair[i];
+
+		hx_copy(dec, ctx->hx_dec);
+		hx_copy(enc, ctx->hx_enc);
+		hx_init_salt(dec, hxk_pair_s1(pair), hxk_pair_s2(pair));
+		hx_init_salt(enc, hxk_pair_s1(pair), hxk_pair_s2(pair));
+
+		hx_transcrypt(dec, enc, pair->ciph, pair->ciph, pair->len);
+	}
+
+	free(dec);
+	free(enc);
+
+	return NULL;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* hohha key format: jumps, length, salt, body */
+static struct hx_state *hxr_key(char *arg, char opt)
+{
+	struct hx_state *hx;
+	uint8_t *raw_K;
+	size_t raw_K_len;
+	uint32_t num_l;
+
+	if (b64_decode(arg, strlen(arg), NULL, &raw_K_len) || raw_K_len < 11)
+		goto err;
+
+	raw_K = malloc(raw_K_len);
+	b64_decode(arg, strlen(arg), raw_K, &raw_K_len);
+
+	num_l = raw_K[1] | (raw_K[2] << 8);
+	if (!num_l || !is_pow2(num_l) || raw_K_len - 11 < num_l)
+		goto err;
+
+	hx = malloc(hx_size(num_l));
+	hx_init(hx, raw_K + 11, num_l, raw_K[0], 0, 0, 0);
+
+	free(raw_K);
+
+	return hx;
+err:
+	fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct hxr_ctx ctx;
+	struct hxr_job *job;
+	struct timespec ts_start, ts_end;
+	pthread_t *thr;
+	FILE *in = stdin;
+	FILE *out = stdout;
+	char *text = NULL;
+	uint64_t bytes = 0;
+	double secs;
+
+	int rc, errflg = 0;
+
+	char *arg_f = NULL;
+	char *arg_o = NULL;
+	char *arg_K = NULL;
+	char *arg_N = NULL;
+	char *arg_t = NULL;
+
+	uint32_t num_t = 1;
+	uint32_t t;
+	size_t i, per;
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "f:o:K:N:t:v")) != -1) {
+		switch (rc) {
+		case 'f': /* input file: string */
+			arg_f = optarg;
+			break;
+		case 'o': /* output file: string */
+			arg_o = optarg;
+			break;
+
+		case 'K': /* old key: base64 (hohha format) */
+			arg_K = optarg;
+			break;
+		case 'N': /* new key: base64 (hohha format) */
+			arg_N = optarg;
+			break;
+
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_K || !arg_N) {
+		fprintf(stderr, "missing one of the required options\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s -K <key> -N <key> <options> [-v]\n"
+			"\n"
+			"  Options:\n"
+			"    -K <key>\n"
+			"      Old key, hohha key format (base64) (required)\n"
+			"    -N <key>\n"
+			"      New key, hohha key format (base64) (required)\n"
+			"    -f <file>\n"
+			"      Read corpus from file (text or binary) (default: stdin)\n"
+			"    -o <file>\n"
+			"      Write corpus to file, same format (default: stdout)\n"
+			"    -t <threads>\n"
+			"      Number of threads (default: 1)\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	ctx.hx_dec = hxr_key(arg_K, 'K');
+	ctx.hx_enc = hxr_key(arg_N, 'N');
+
+	if (arg_t) {
+		unsigned long val;
+
+		errno = 0;
+		val = strtoul(arg_t, NULL, 0);
+		if (errno || !val || val > 1024) {
+			fprintf(stderr, "invalid -t '%s'\n", arg_t);
+			exit(1);
+		}
+
+		num_t = (uint32_t)val;
+	}
+
+	if (arg_f) {
+		in = fopen(arg_f, "r");
+		if (!in) {
+			fprintf(stderr, "invalid -f '%s'\n", arg_f);
+			exit(1);
+		}
+	}
+
+	if (hxk_read(&ctx.kpa, in)) {
+		fprintf(stderr, "invalid or truncated corpus\n");
+		exit(1);
+	}
+
+	if (in != stdin)
+		fclose(in);
+
+	if (arg_o) {
+		out = fopen(arg_o, "w");
+		if (!out) {
+			fprintf(stderr, "invalid -o '%s'\n", arg_o);
+			exit(1);
+		}
+	}
+
+	job = calloc(num_t, sizeof(*job));
+	thr = calloc(num_t, sizeof(*thr));
+
+	per = (ctx.kpa.count + num_t - 1) / num_t;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+	for (t = 0; t < num_t; ++t) {
+		job[t].ctx = &ctx;
+		job[t].first = per * t;
+		job[t].count = 0;
+		if (job[t].first < ctx.kpa.count)
+			job[t].count = ctx.kpa.count - job[t].first;
+		if (job[t].count > per)
+			job[t].count = per;
+
+		if (num_t == 1)
+			hxr_job_run(&job[t]);
+		else
+			pthread_create(&thr[t], NULL, hxr_job_run, &job[t]);
+	}
+
+	for (t = 0; t < num_t && num_t != 1; ++t)
+		pthread_join(thr[t], NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	secs = (ts_end.tv_sec - ts_start.tv_sec) +
+		(ts_end.tv_nsec - ts_start.tv_nsec) * 1e-9;
+
+	for (i = 0; i < ctx.kpa.count; ++i)
+		bytes += ctx.kpa.pair[i].len;
+
+	dbg("records: %zu bytes: %" PRIu64 " in %.3fs (%.1f MB/s)\n",
+	    ctx.kpa.count, bytes, secs, secs > 0 ? bytes / secs / 1e6 : 0);
+
+	if (ctx.kpa.bin) {
+		/* binary records are contiguous, after the header */
+		rc = hxk_write_head(out, ctx.hx_enc->key_jumps,
+				    ctx.hx_enc->key_mask + 1,
+				    ctx.kpa.count ? ctx.kpa.pair[0].len : 0,
+				    ctx.kpa.count);
+		if (!rc && ctx.kpa.count)
+			rc = fwrite(ctx.kpa.data,
+				    hxk_bin_len(ctx.kpa.pair[0].len),
+				    ctx.kpa.count, out) != ctx.kpa.count;
+	} else {
+		for (i = 0, rc = 0; i < ctx.kpa.count && !rc; ++i) {
+			text = realloc(text,
+				       hxk_text_len(ctx.kpa.pair[i].len));
+			hxk_fmt_text(text, &ctx.kpa.pair[i]);
+			rc = fputs(text, out) < 0;
+		}
+	}
+
+	if (fclose(out) || rc) {
+		fprintf(stderr, "write failed\n");
+		exit(1);
+	}
+
+	free(text);
+	free(job);
+	free(thr);
+	free(ctx.hx_dec);
+	free(ctx.hx_enc);
+	hxk_free(&ctx.kpa);
+
+	return 0;
+}
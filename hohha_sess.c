@@ -0,0 +1,533 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hohha_sess.h"
+#include "hohha_util.h"
+
+/* empty slot of an overlay, not a slot of any key up to HXS_KEY_MAX */
+#define HXS_SLOT_NONE 0xffff
+
+/* smallest overlay, when the stream first mutates the key */
+#define HXS_OV_MIN 16
+
+/* no free session record */
+#define HXS_FREE_NONE UINT32_MAX
+
+struct hxs_key *hxs_key_new(uint8_t *key, uint32_t key_len,
+			    uint32_t key_jumps)
+{
+	struct hxs_key *hk;
+
+	if (!key_len || !is_pow2(key_len) || key_len > HXS_KEY_MAX)
+		return NULL;
+
+	/* Note: reference alg always jumps at least twice */
+	if (key_jumps < 2)
+		return NULL;
+
+	hk = malloc(sizeof(*hk) + key_len);
+	if (!hk)
+		return NULL;
+
+	hk->ref = 1;
+	hk->key_len = key_len;
+	hk->key_jumps = key_jumps;
+	hk->v = crc32_data(key, key_len);
+	memcpy(hk->key, key, key_len);
+
+	return hk;
+}
+
+void hxs_key_put(struct hxs_key *hk)
+{
+	/* tables of other threads may share the key */
+	if (hk && !__atomic_sub_fetch(&hk->ref, 1, __ATOMIC_ACQ_REL))
+		free(hk);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint8_t *hxs_ov_val(struct hxs_sess *s)
+{
+	return (uint8_t *)(s->ov_slot + s->ov_cap);
+}
+
+static size_t hxs_ov_size(uint32_t cap)
+{
+	return cap * (sizeof(uint16_t) + sizeof(uint8_t));
+}
+
+/*
+ * Move the overlay to a new capacity, or free it if the capacity is zero.
+ *
+ * If key is not NULL, drop slots that equal the key.
+ */
+static void hxs_ov_resize(struct hxs_sess *s, uint32_t cap, uint8_t *key)
+{
+	uint16_t *old_slot = s->ov_slot;
+	uint8_t *old_val = hxs_ov_val(s);
+	uint32_t old_cap = s->ov_cap;
+	uint8_t *val;
+	uint32_t i, j;
+
+	s->ov_slot = NULL;
+	s->ov_cap = cap;
+	s->ov_count = 0;
+
+	if (cap) {
+		s->ov_slot = malloc(hxs_ov_size(cap));
+		memset(s->ov_slot, 0xff, cap * sizeof(uint16_t));
+	}
+
+	val = hxs_ov_val(s);
+
+	for (i = 0; i < old_cap && cap; ++i) {
+		if (old_slot[i] == HXS_SLOT_NONE)
+			continue;
+		if (key && key[old_slot[i]] == old_val[i])
+			continue;
+
+		for (j = old_slot[i] & (cap - 1);
+		     s->ov_slot[j] != HXS_SLOT_NONE;
+		     j = (j + 1) & (cap - 1));
+
+		s->ov_slot[j] = old_slot[i];
+		val[j] = old_val[i];
+		++s->ov_count;
+	}
+
+	free(old_slot);
+}
+
+/* smallest overlay with room for some slots, and the jumps of one byte */
+static uint32_t hxs_ov_fit(uint32_t count, uint32_t jumps)
+{
+	uint32_t cap = HXS_OV_MIN;
+
+	while (count + jumps > cap - cap / 4)
+		cap <<= 1;
+
+	return cap;
+}
+
+/* copy the shared key and the overlay to a private state */
+static void hxs_dense(struct hxs_sess *s)
+{
+	struct hxs_key *hk = s->base;
+	struct hx_state *hx;
+	uint8_t *val = hxs_ov_val(s);
+	uint32_t i;
+
+	hx = malloc(hx_size(hk->key_len));
+
+	memcpy(hx->key, hk->key, hk->key_len);
+	for (i = 0; i < s->ov_cap; ++i)
+		if (s->ov_slot[i] != HXS_SLOT_NONE)
+			hx->key[s->ov_slot[i]] = val[i];
+
+	hx->key_mask = hk->key_len - 1;
+	hx->key_jumps = hk->key_jumps;
+	hx->s1 = s->s1;
+	hx->s2 = s->s2;
+	hx->m = s->m;
+	hx->v = s->v;
+	hx->cs = s->cs;
+	hx_init_opt(hx, 0);
+
+	hxs_ov_resize(s, 0, NULL);
+	s->hx = hx;
+}
+
+/* copy the mutated slots of a private state to an overlay */
+static void hxs_sparse(struct hxs_sess *s, uint32_t cap)
+{
+	struct hxs_key *hk = s->base;
+	struct hx_state *hx = s->hx;
+	uint8_t *val;
+	uint32_t i, j;
+
+	s->ov_slot = malloc(hxs_ov_size(cap));
+	memset(s->ov_slot, 0xff, cap * sizeof(uint16_t));
+	s->ov_cap = cap;
+	s->ov_count = 0;
+	val = hxs_ov_val(s);
+
+	for (i = 0; i < hk->key_len; ++i) {
+		if (hx->key[i] == hk->key[i])
+			continue;
+
+		for (j = i & (cap - 1);
+		     s->ov_slot[j] != HXS_SLOT_NONE;
+		     j = (j + 1) & (cap - 1));
+
+		s->ov_slot[j] = i;
+		val[j] = hx->key[i];
+		++s->ov_count;
+	}
+
+	s->s1 = hx->s1;
+	s->s2 = hx->s2;
+	s->m = hx->m;
+	s->v = hx->v;
+	s->cs = hx->cs;
+
+	free(hx);
+	s->hx = NULL;
+}
+
+/*
+ * Make room in the overlay for the jumps of one byte.
+ *
+ * Returns nonzero if the overlay would be larger than the key, and the
+ * session now has a private state instead.
+ */
+static int hxs_reserve(struct hxs_sess *s)
+{
+	struct hxs_key *hk = s->base;
+	uint32_t cap = s->ov_cap;
+
+	if (cap && s->ov_count + hk->key_jumps <= cap - cap / 4)
+		return 0;
+
+	cap = hxs_ov_fit(s->ov_count, hk->key_jumps);
+
+	if (hxs_ov_size(cap) >= hk->key_len) {
+		hxs_dense(s);
+		return 1;
+	}
+
+	hxs_ov_resize(s, cap, NULL);
+
+	return 0;
+}
+
+/* set a slot of the key, and return its previous value */
+static inline uint8_t hxs_swap(struct hxs_sess *s, uint8_t *key,
+			       uint32_t slot, uint8_t word)
+{
+	uint32_t i, mask = s->ov_cap - 1;
+	uint8_t *val = hxs_ov_val(s);
+	uint8_t prev;
+
+	for (i = slot & mask; s->ov_slot[i] != HXS_SLOT_NONE;
+	     i = (i + 1) & mask) {
+		if (s->ov_slot[i] == slot) {
+			prev = val[i];
+			val[i] = word;
+			return prev;
+		}
+	}
+
+	/* Note: the same as the shared key needs no slot */
+	prev = key[slot];
+	if (prev != word) {
+		s->ov_slot[i] = slot;
+		val[i] = word;
+		++s->ov_count;
+	}
+
+	return prev;
+}
+
+/* the jumps of hx_jump_each(), through the overlay */
+static inline void hxs_jump(struct hxs_sess *s, struct hxs_key *hk)
+{
+	uint32_t j, mask = hk->key_len - 1;
+
+	for (j = 0; j < hk->key_jumps; ++j) {
+		if (j & 1) {
+			s->s2 ^= hxs_swap(s, hk->key, s->m, u8(s->s1));
+			s->m ^= j == 1 ? s->v : s->s1;
+			s->m &= mask;
+			s->s1 = ror32(s->s1, 1);
+		} else {
+			s->s1 ^= hxs_swap(s, hk->key, s->m, u8(s->s2));
+			s->m ^= j == 0 ? s->s2 : s->v;
+			s->m &= mask;
+			s->s2 = rol32(s->s2, 1);
+		}
+	}
+}
+
+static inline void hxs_step_crc(struct hxs_sess *s, uint8_t word)
+{
+	s->cs = crc32_byte(s->cs, word);
+	s->v = rol32(s->v ^ s->cs, 1);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static struct hxs_sess *hxs_rec(struct hxs_table *tab, uint32_t idx)
+{
+	return &tab->slab[idx >> HXS_SLAB_SHIFT][idx & (HXS_SLAB_LEN - 1)];
+}
+
+static void hxs_slab_add(struct hxs_table *tab)
+{
+	struct hxs_sess *slab;
+	uint32_t i, first;
+
+	if (tab->slab_count == tab->slab_cap) {
+		tab->slab_cap = tab->slab_cap ? tab->slab_cap << 1 : 16;
+		tab->slab = realloc(tab->slab,
+				    tab->slab_cap * sizeof(*tab->slab));
+	}
+
+	slab = calloc(HXS_SLAB_LEN, sizeof(*slab));
+	first = tab->slab_count << HXS_SLAB_SHIFT;
+
+	/* free records in order, first at the head */
+	for (i = 0; i < HXS_SLAB_LEN; ++i) {
+		slab[i].gen = 1;
+		slab[i].next_free = first + i + 1;
+	}
+	slab[HXS_SLAB_LEN - 1].next_free = tab->free_head;
+
+	tab->slab[tab->slab_count++] = slab;
+	tab->free_head = first;
+}
+
+void hxs_init(struct hxs_table *tab)
+{
+	memset(tab, 0, sizeof(*tab));
+	tab->free_head = HXS_FREE_NONE;
+}
+
+static void hxs_release(struct hxs_sess *s)
+{
+	hxs_key_put(s->base);
+	free(s->hx);
+	free(s->ov_slot);
+
+	s->base = NULL;
+	s->hx = NULL;
+	s->ov_slot = NULL;
+	s->ov_cap = 0;
+	s->ov_count = 0;
+
+	/* Note: a stale id never matches, and id zero is never valid */
+	if (!++s->gen)
+		s->gen = 1;
+}
+
+void hxs_free(struct hxs_table *tab)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < tab->slab_count; ++i) {
+		for (j = 0; j < HXS_SLAB_LEN; ++j)
+			if (tab->slab[i][j].base)
+				hxs_release(&tab->slab[i][j]);
+		free(tab->slab[i]);
+	}
+
+	free(tab->slab);
+	hxs_init(tab);
+}
+
+uint64_t hxs_open(struct hxs_table *tab, struct hxs_key *hk,
+		  uint32_t s1, uint32_t s2)
+{
+	struct hxs_sess *s;
+	uint32_t idx;
+
+	if (tab->free_head == HXS_FREE_NONE)
+		hxs_slab_add(tab);
+
+	idx = tab->free_head;
+	s = hxs_rec(tab, idx);
+	tab->free_head = s->next_free;
+
+	__atomic_add_fetch(&hk->ref, 1, __ATOMIC_RELAXED);
+	s->base = hk;
+
+	/* the same as hx_init_key() and hx_init_salt() */
+	s->s1 = s1;
+	s->s2 = s2;
+	s->m = (s1 >> 24) * (s2 >> 24);
+	s->m &= hk->key_len - 1;
+	s->v = hk->v;
+	s->cs = ~0;
+	s->tick = tab->tick;
+
+	++tab->live;
+
+	return ((uint64_t)s->gen << 32) | idx;
+}
+
+struct hxs_sess *hxs_find(struct hxs_table *tab, uint64_t id)
+{
+	uint32_t idx = u32(id);
+	struct hxs_sess *s;
+
+	if ((idx >> HXS_SLAB_SHIFT) >= tab->slab_count)
+		return NULL;
+
+	s = hxs_rec(tab, idx);
+	if (!s->base || s->gen != u32(id >> 32))
+		return NULL;
+
+	return s;
+}
+
+int hxs_close(struct hxs_table *tab, uint64_t id)
+{
+	struct hxs_sess *s = hxs_find(tab, id);
+
+	if (!s)
+		return -1;
+
+	hxs_release(s);
+
+	s->next_free = tab->free_head;
+	tab->free_head = u32(id);
+	--tab->live;
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static int hxs_crypt(struct hxs_table *tab, uint64_t id,
+		     uint8_t *in_buf, uint8_t *out_buf, uint32_t len,
+		     int decrypt)
+{
+	struct hxs_sess *s = hxs_find(tab, id);
+	uint32_t i;
+	uint8_t x, word;
+
+	if (!s)
+		return -1;
+
+	s->tick = ++tab->tick;
+
+	for (i = 0; i < len && !s->hx; ++i) {
+		if (hxs_reserve(s))
+			break;
+
+		hxs_jump(s, s->base);
+
+		x = u8(s->v ^ s->s1 ^ s->s2);
+		word = in_buf[i];
+		out_buf[i] = word ^ x;
+
+		/* the plain text is the input, or the output */
+		hxs_step_crc(s, decrypt ? out_buf[i] : word);
+	}
+
+	if (i < len) {
+		if (decrypt)
+			hx_decrypt(s->hx, in_buf + i, out_buf + i, len - i);
+		else
+			hx_encrypt(s->hx, in_buf + i, out_buf + i, len - i);
+	}
+
+	return 0;
+}
+
+int hxs_encrypt(struct hxs_table *tab, uint64_t id,
+		uint8_t *in_buf, uint8_t *out_buf, uint32_t len)
+{
+	return hxs_crypt(tab, id, in_buf, out_buf, len, 0);
+}
+
+int hxs_decrypt(struct hxs_table *tab, uint64_t id,
+		uint8_t *in_buf, uint8_t *out_buf, uint32_t len)
+{
+	return hxs_crypt(tab, id, in_buf, out_buf, len, 1);
+}
+
+uint32_t hxs_text_crc(struct hxs_sess *s)
+{
+	if (s->hx)
+		return hx_text_crc(s->hx);
+
+	return ~s->cs;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static size_t hxs_sess_size(struct hxs_sess *s)
+{
+	if (s->hx)
+		return hx_size(s->base->key_len);
+
+	return hxs_ov_size(s->ov_cap);
+}
+
+static void hxs_compact_sess(struct hxs_sess *s)
+{
+	struct hxs_key *hk = s->base;
+	uint32_t i, count = 0, cap;
+
+	if (s->hx) {
+		for (i = 0; i < hk->key_len; ++i)
+			count += s->hx->key[i] != hk->key[i];
+
+		cap = hxs_ov_fit(count, hk->key_jumps);
+		if (hxs_ov_size(cap) < hk->key_len)
+			hxs_sparse(s, cap);
+
+		return;
+	}
+
+	if (!s->ov_cap)
+		return;
+
+	/* drop slots that went back to the shared key, then shrink */
+	hxs_ov_resize(s, s->ov_cap, hk->key);
+
+	if (!s->ov_count)
+		hxs_ov_resize(s, 0, NULL);
+	else
+		hxs_ov_resize(s, hxs_ov_fit(s->ov_count, 0), NULL);
+}
+
+size_t hxs_compact(struct hxs_table *tab, uint64_t idle)
+{
+	struct hxs_sess *s;
+	size_t freed = 0, size;
+	uint32_t i, j;
+
+	for (i = 0; i < tab->slab_count; ++i) {
+		for (j = 0; j < HXS_SLAB_LEN; ++j) {
+			s = &tab->slab[i][j];
+			if (!s->base || tab->tick - s->tick < idle)
+				continue;
+
+			size = hxs_sess_size(s);
+			hxs_compact_sess(s);
+			freed += size - hxs_sess_size(s);
+		}
+	}
+
+	return freed;
+}
+
+void hxs_stat(struct hxs_table *tab, struct hxs_stat *stat)
+{
+	struct hxs_sess *s;
+	uint32_t i, j;
+
+	memset(stat, 0, sizeof(*stat));
+
+	stat->live = tab->live;
+	stat->bytes = (uint64_t)tab->slab_count * HXS_SLAB_LEN * sizeof(*s);
+
+	for (i = 0; i < tab->slab_count; ++i) {
+		for (j = 0; j < HXS_SLAB_LEN; ++j) {
+			s = &tab->slab[i][j];
+			if (!s->base)
+				continue;
+
+			if (s->hx) {
+				++stat->dense;
+			} else {
+				++stat->sparse;
+				stat->slots += s->ov_count;
+			}
+
+			stat->bytes += hxs_sess_size(s);
+		}
+	}
+}
@@ -0,0 +1,169 @@
+#ifndef HOHHA_SESS_H
+#define HOHHA_SESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hohha_xor.h"
+
+/*
+ * Table of many long lived streams, sharing keys.
+ *
+ * Each hx_state has its own copy of the key body, which the stream mutates,
+ * so many streams with long keys need a lot of memory.  Here, sessions of
+ * the same key share one read only copy of the key body, and each session
+ * stores only the slots of the key that its stream has mutated, in a small
+ * hash table.  The memory of a session grows with the bytes it has
+ * processed, until the overlay would be larger than the key body.  Then the
+ * session gets a private hx_state, and runs as fast as hx_encrypt().
+ *
+ * Idle sessions may be compacted: slots that equal the shared key are
+ * dropped, and the overlay is shrunk to fit, or a private state that has
+ * few mutated slots goes back to an overlay.
+ *
+ * Session records are allocated in slabs, and never move.  A session id is
+ * the index of its record and a generation, so a stale id is detected, and
+ * a session is found in constant time.
+ *
+ * The table is not locked.  Callers serialize access to a table, or use
+ * one table per thread.  A shared key may be used by the tables of many
+ * threads: its references are counted atomically.
+ */
+
+/* longest key body of a session, with room for the empty slot marker */
+#define HXS_KEY_MAX (1u << 15)
+
+/* session records in each slab */
+#define HXS_SLAB_SHIFT 12
+#define HXS_SLAB_LEN (1u << HXS_SLAB_SHIFT)
+
+struct hxs_key {
+	uint32_t ref;			/* sessions and owner, atomic */
+	uint32_t key_len;		/* length of the key body */
+	uint32_t key_jumps;		/* number of jumps */
+	uint32_t v;			/* crc of the key body */
+	uint8_t key[];			/* shared key body, read only */
+};
+
+struct hxs_sess {
+	struct hxs_key *base;		/* shared key, or NULL if free */
+	struct hx_state *hx;		/* private state, or NULL if sparse */
+	uint16_t *ov_slot;		/* overlay slots, then values */
+	uint32_t ov_cap;		/* overlay capacity, power of two */
+	uint32_t ov_count;		/* slots in the overlay */
+	uint32_t gen;			/* generation of the record */
+	uint32_t next_free;		/* next free record */
+	uint32_t s1, s2, m, v, cs;	/* stream, if sparse */
+	uint64_t tick;			/* table tick of the last use */
+};
+
+struct hxs_table {
+	struct hxs_sess **slab;		/* slabs of session records */
+	uint32_t slab_count;		/* slabs allocated */
+	uint32_t slab_cap;		/* capacity of the slab array */
+	uint32_t free_head;		/* first free record */
+	uint32_t live;			/* open sessions */
+	uint64_t tick;			/* operations on the table */
+};
+
+struct hxs_stat {
+	uint64_t live;			/* open sessions */
+	uint64_t sparse;		/* sessions with an overlay */
+	uint64_t dense;			/* sessions with a private state */
+	uint64_t slots;			/* slots in all overlays */
+	uint64_t bytes;			/* memory of records, overlays, states */
+};
+
+/**
+ * Create a shared key.
+ *
+ * Returns the key, with one reference for the caller, or NULL if the key
+ * length is not a power of two up to HXS_KEY_MAX, jumps is less than two,
+ * or out of memory.
+ *
+ * @key - key body to copy
+ * @key_len - length of the key body
+ * @key_jumps - number of jumps
+ */
+HX_API struct hxs_key *hxs_key_new(uint8_t *key, uint32_t key_len,
+				   uint32_t key_jumps);
+
+/**
+ * Release a reference to a shared key, and free it with the last one.
+ */
+HX_API void hxs_key_put(struct hxs_key *key);
+
+/**
+ * Initialize an empty table.
+ */
+HX_API void hxs_init(struct hxs_table *tab);
+
+/**
+ * Close every session, and free the table.
+ */
+HX_API void hxs_free(struct hxs_table *tab);
+
+/**
+ * Open a session, with a reference to a shared key.
+ *
+ * Returns the session id, which is never zero.
+ *
+ * @tab - session table
+ * @key - shared key of the session
+ * @s1 - first salt
+ * @s2 - second salt
+ */
+HX_API uint64_t hxs_open(struct hxs_table *tab, struct hxs_key *key,
+			 uint32_t s1, uint32_t s2);
+
+/**
+ * Close a session, and release its key.
+ *
+ * Returns zero, or nonzero if there is no such session.
+ */
+HX_API int hxs_close(struct hxs_table *tab, uint64_t id);
+
+/**
+ * Find a session by id.
+ *
+ * Returns the session, or NULL if the id is stale or invalid.
+ */
+HX_API struct hxs_sess *hxs_find(struct hxs_table *tab, uint64_t id);
+
+/**
+ * Encrypt, or decrypt, the next bytes of the stream of a session.
+ *
+ * Returns zero, or nonzero if there is no such session.
+ *
+ * @tab - session table
+ * @id - session id
+ * @in_buf - input text
+ * @out_buf - output text, may be the same as input
+ * @len - length of the text
+ */
+HX_API int hxs_encrypt(struct hxs_table *tab, uint64_t id,
+		       uint8_t *in_buf, uint8_t *out_buf, uint32_t len);
+HX_API int hxs_decrypt(struct hxs_table *tab, uint64_t id,
+		       uint8_t *in_buf, uint8_t *out_buf, uint32_t len);
+
+/**
+ * Crc of the plain text of a session, like hx_text_crc().
+ */
+HX_API uint32_t hxs_text_crc(struct hxs_sess *sess);
+
+/**
+ * Compact the sessions that have been idle for some operations.
+ *
+ * Returns the number of bytes freed.
+ *
+ * @tab - session table
+ * @idle - operations on the table since the last use of a session
+ */
+HX_API size_t hxs_compact(struct hxs_table *tab, uint64_t idle);
+
+/**
+ * Count the sessions and memory of a table.
+ */
+HX_API void hxs_stat(struct hxs_table *tab, struct hxs_stat *stat);
+
+#endif
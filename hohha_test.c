@@ -0,0 +1,632 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_sess.h"
+
+/* --- --- --- --- --- --- --- --- --- */
+
+enum hxt_mode {
+	HXT_MODE_ONE,			/* encrypt or decrypt in one call */
+	HXT_MODE_SNAP,			/* resume from a snapshot halfway */
+	HXT_MODE_FAN,			/* encrypt with copies of the state */
+	HXT_MODE_TRANS,			/* transcrypt from a different key */
+	HXT_MODE_SESS,			/* sessions of a shared key */
+};
+
+struct hxt_variant {
+	const char *name;
+	uint32_t opt;
+	enum hxt_mode mode;
+};
+
+static const struct hxt_variant hxt_variants[] = {
+	{ "opt", 0, HXT_MODE_ONE },
+	{ "any", HX_OPT_JUMP_ANY, HXT_MODE_ONE },
+	{ "each", HX_OPT_JUMP_N, HXT_MODE_ONE },
+	{ "snap", 0, HXT_MODE_SNAP },
+	{ "fan", 0, HXT_MODE_FAN },
+	{ "trans", 0, HXT_MODE_TRANS },
+	{ "sess", 0, HXT_MODE_SESS },
+};
+
+/* copies of the state in fan mode, more than fit in the lanes */
+#define HXT_FAN 5
+
+#define HXT_VARIANTS (sizeof(hxt_variants) / sizeof(*hxt_variants))
+
+struct hxt_vec {
+	uint32_t key_jumps;		/* number of jumps */
+	uint32_t key_len;		/* length of key body */
+	uint8_t *key;			/* key body */
+	uint32_t s1;			/* first salt */
+	uint32_t s2;			/* second salt */
+	uint8_t *plain;			/* plaintext message */
+	uint8_t *cipher;		/* ciphertext message */
+	size_t len;			/* length of message */
+};
+
+struct hxt_sum {
+	size_t pass;			/* number of passing tests */
+	size_t fail;			/* number of failing tests */
+	uint64_t ns;			/* total time */
+	uint64_t bytes;			/* total bytes */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint64_t hxt_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static char *hxt_read_text(const char *dir, unsigned i, const char *what)
+{
+	char *path;
+	char *text = NULL;
+	size_t len = 0;
+	FILE *f;
+
+	if (asprintf(&path, "%s/%u-%s.txt", dir, i, what) < 0)
+		return NULL;
+
+	f = fopen(path, "r");
+	free(path);
+	if (!f)
+		return NULL;
+
+	if (getdelim(&text, &len, 0, f) < 0) {
+		free(text);
+		text = NULL;
+	}
+
+	fclose(f);
+
+	return text;
+}
+
+static uint8_t *hxt_read_b64(const char *dir, unsigned i, const char *what,
+			     size_t *len)
+{
+	char *text;
+	uint8_t *data = NULL;
+
+	text = hxt_read_text(dir, i, what);
+	if (!text)
+		return NULL;
+
+	if (b64_decode(text, strlen(text), NULL, len))
+		goto out;
+
+	data = malloc(*len + 1);
+	++*len;
+
+	if (b64_decode(text, strlen(text), data, len)) {
+		free(data);
+		data = NULL;
+	}
+out:
+	free(text);
+
+	return data;
+}
+
+static void hxt_vec_free(struct hxt_vec *vec)
+{
+	free(vec->key);
+	free(vec->plain);
+	free(vec->cipher);
+}
+
+/* Load the i'th vector: zero if loaded, one if none, negative if invalid. */
+static int hxt_vec_read(struct hxt_vec *vec, const char *dir, unsigned i)
+{
+	uint8_t *raw_K;
+	size_t raw_K_len;
+	uint8_t raw_S[8];
+	size_t plain_len, cipher_len;
+	char *text;
+	int rc;
+
+	memset(vec, 0, sizeof(*vec));
+
+	text = hxt_read_text(dir, i, "key");
+	if (!text)
+		return 1;
+	free(text);
+
+	raw_K = hxt_read_b64(dir, i, "key", &raw_K_len);
+	if (!raw_K)
+		return -1;
+
+	text = hxt_read_text(dir, i, "salt");
+	if (!text) {
+		free(raw_K);
+		return -1;
+	}
+
+	rc = sscanf(text, "%hhu %hhu %hhu %hhu %hhu %hhu %hhu %hhu",
+		    &raw_S[0], &raw_S[1], &raw_S[2], &raw_S[3],
+		    &raw_S[4], &raw_S[5], &raw_S[6], &raw_S[7]);
+	free(text);
+
+	/* hohha key format: jumps, length, salt, body */
+	if (rc != 8 || raw_K_len < 11) {
+		free(raw_K);
+		return -1;
+	}
+
+	vec->key_jumps = raw_K[0];
+	vec->key_len = raw_K[1] | (raw_K[2] << 8);
+	vec->s1 = leu32(raw_S + 0);
+	vec->s2 = leu32(raw_S + 4);
+
+	if (vec->key_len > raw_K_len - 11) {
+		free(raw_K);
+		return -1;
+	}
+
+	vec->key = malloc(vec->key_len);
+	memcpy(vec->key, raw_K + 11, vec->key_len);
+	free(raw_K);
+
+	vec->plain = hxt_read_b64(dir, i, "plain", &plain_len);
+	vec->cipher = hxt_read_b64(dir, i, "cipher", &cipher_len);
+	vec->len = plain_len;
+
+	if (!vec->plain || !vec->cipher || plain_len != cipher_len) {
+		hxt_vec_free(vec);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+typedef void (*hxt_crypt_fn)(struct hx_state *hx, uint8_t *in_buf,
+			     uint8_t *out_buf, uint32_t len);
+
+/*
+ * The variants below add to *ns the time of only the library calls under
+ * test, not of allocating their buffers or checking their results.
+ */
+
+/*
+ * Encrypt with copies of the state, each the same as hx_encrypt.  The time
+ * is per state, to compare with encrypting one message.
+ */
+static void hxt_crypt_fan(struct hx_state *hx, uint8_t *in, uint8_t *out,
+			  uint32_t len, uint64_t *ns)
+{
+	struct hx_state *fan_hx[HXT_FAN];
+	uint8_t *fan_out[HXT_FAN];
+	struct hx_fan *fan;
+	size_t sz_hx = hx_size(hx->key_mask + 1);
+	unsigned k;
+	uint64_t t;
+	int bad = 0;
+
+	fan = malloc(hx_fan_size(len));
+
+	for (k = 0; k < HXT_FAN; ++k) {
+		fan_hx[k] = malloc(sz_hx);
+		hx_copy(fan_hx[k], hx);
+		fan_out[k] = malloc(len + 1);
+	}
+
+	t = hxt_now();
+	hx_fan_init(fan, hx->cs, in, len);
+	if (hx_fan_encrypt(fan, fan_hx, HXT_FAN, in, fan_out))
+		bad = 1;
+	*ns += (hxt_now() - t) / HXT_FAN;
+
+	/* each state must end the same as by hx_encrypt */
+	hx_encrypt(hx, in, out, len);
+
+	for (k = 0; k < HXT_FAN; ++k) {
+		if (memcmp(out, fan_out[k], len) ||
+		    memcmp(hx, fan_hx[k], sz_hx))
+			bad = 1;
+	}
+
+	if (bad)
+		memset(out, 0, len);
+
+	for (k = 0; k < HXT_FAN; ++k) {
+		free(fan_hx[k]);
+		free(fan_out[k]);
+	}
+
+	free(fan);
+}
+
+/*
+ * Encrypt with another key, one bit different, then transcrypt the
+ * ciphertext from that key to the state.  The old state must have
+ * decrypted the plaintext, checked by its crc.
+ */
+static void hxt_crypt_trans(struct hx_state *hx, uint8_t *in, uint8_t *out,
+			    uint32_t len, uint64_t *ns)
+{
+	uint32_t key_len = hx->key_mask + 1;
+	struct hx_state *dec = malloc(hx_size(key_len));
+	uint8_t *key = malloc(key_len);
+	uint64_t t;
+
+	memcpy(key, hx->key, key_len);
+	key[0] ^= 1;
+
+	hx_init(dec, key, key_len, hx->key_jumps, hx->s1, hx->s2, hx->opt);
+	hx_encrypt(dec, in, out, len);
+
+	hx_init(dec, key, key_len, hx->key_jumps, hx->s1, hx->s2, hx->opt);
+	t = hxt_now();
+	hx_transcrypt(dec, hx, out, out, len);
+	*ns += hxt_now() - t;
+
+	if (hx_text_crc(dec) != crc32_data(in, len))
+		memset(out, 0, len);
+
+	free(key);
+	free(dec);
+}
+
+/*
+ * Encrypt or decrypt with two sessions of a shared key, one in a single
+ * call, and one in parts, compacted between them.  Only the single call
+ * is timed.
+ */
+static void hxt_crypt_sess(hxt_crypt_fn fn, struct hx_state *hx,
+			   uint8_t *in, uint8_t *out, uint32_t len,
+			   uint64_t *ns)
+{
+	struct hxs_table tab;
+	struct hxs_key *hk;
+	uint64_t id[2];
+	uint8_t *part;
+	uint32_t i, n;
+	uint64_t t;
+	int bad = 0;
+
+	hk = hxs_key_new(hx->key, hx->key_mask + 1, hx->key_jumps);
+	if (!hk) {
+		memset(out, 0, len);
+		return;
+	}
+
+	hxs_init(&tab);
+	id[0] = hxs_open(&tab, hk, hx->s1, hx->s2);
+	id[1] = hxs_open(&tab, hk, hx->s1, hx->s2);
+	hxs_key_put(hk);
+
+	part = malloc(len + 1);
+
+	t = hxt_now();
+	if (fn == hx_encrypt)
+		hxs_encrypt(&tab, id[0], in, out, len);
+	else
+		hxs_decrypt(&tab, id[0], in, out, len);
+	*ns += hxt_now() - t;
+
+	for (i = 0; i < len; i += n) {
+		n = len - i < 7 ? len - i : 7;
+
+		if (fn == hx_encrypt)
+			hxs_encrypt(&tab, id[1], in + i, part + i, n);
+		else
+			hxs_decrypt(&tab, id[1], in + i, part + i, n);
+
+		hxs_compact(&tab, 0);
+	}
+
+	if (memcmp(out, part, len) ||
+	    hxs_text_crc(hxs_find(&tab, id[0])) !=
+	    hxs_text_crc(hxs_find(&tab, id[1])))
+		bad = 1;
+
+	if (hxs_close(&tab, id[0]) || !hxs_close(&tab, id[0]))
+		bad = 1;
+
+	if (bad)
+		memset(out, 0, len);
+
+	free(part);
+	hxs_free(&tab);
+}
+
+/* Encrypt or decrypt, maybe through a snapshot of the state halfway. */
+static void hxt_crypt(const struct hxt_variant *var, hxt_crypt_fn fn,
+		      struct hx_state *hx, uint8_t *in, uint8_t *out,
+		      uint32_t len, uint64_t *ns)
+{
+	uint32_t half = len / 2;
+	uint8_t *snap;
+	size_t snap_len;
+	uint64_t t;
+	int rc;
+
+	if (var->mode == HXT_MODE_FAN && fn == hx_encrypt) {
+		hxt_crypt_fan(hx, in, out, len, ns);
+		return;
+	}
+
+	if (var->mode == HXT_MODE_TRANS && fn == hx_encrypt) {
+		hxt_crypt_trans(hx, in, out, len, ns);
+		return;
+	}
+
+	if (var->mode == HXT_MODE_SESS) {
+		hxt_crypt_sess(fn, hx, in, out, len, ns);
+		return;
+	}
+
+	if (var->mode != HXT_MODE_SNAP) {
+		t = hxt_now();
+		fn(hx, in, out, len);
+		*ns += hxt_now() - t;
+		return;
+	}
+
+	snap = malloc(hx_snap_len(hx));
+
+	t = hxt_now();
+	fn(hx, in, out, half);
+	snap_len = hx_snap_save(hx, snap);
+	*ns += hxt_now() - t;
+
+	/* nothing must survive but the snapshot */
+	memset(hx, 0xa5, hx_size(hx->key_mask + 1));
+
+	t = hxt_now();
+	rc = hx_snap_load(hx, snap, snap_len);
+	if (!rc)
+		fn(hx, in + half, out + half, len - half);
+	*ns += hxt_now() - t;
+
+	if (rc)
+		memset(out + half, 0, len - half);
+
+	free(snap);
+}
+
+#define HXT_FAIL_E 1
+#define HXT_FAIL_D 2
+
+/* Run one vector in one variant, returning which of HXT_FAIL_*. */
+static int hxt_vec_run(struct hxt_vec *vec, const struct hxt_variant *var,
+		       struct hx_state *hx, uint8_t *out, unsigned repeat,
+		       uint64_t *ns_e, uint64_t *ns_d)
+{
+	unsigned r;
+	int fail = 0;
+
+	/* time only the algorithm, not initializing the key */
+
+	*ns_e = 0;
+	for (r = 0; r < repeat; ++r) {
+		hx_init(hx, vec->key, vec->key_len, vec->key_jumps,
+			vec->s1, vec->s2, var->opt);
+		hxt_crypt(var, hx_encrypt, hx, vec->plain, out, vec->len,
+			  ns_e);
+	}
+
+	if (memcmp(out, vec->cipher, vec->len))
+		fail |= HXT_FAIL_E;
+
+	*ns_d = 0;
+	for (r = 0; r < repeat; ++r) {
+		hx_init(hx, vec->key, vec->key_len, vec->key_jumps,
+			vec->s1, vec->s2, var->opt);
+		hxt_crypt(var, hx_decrypt, hx, vec->cipher, out, vec->len,
+			  ns_d);
+	}
+
+	if (memcmp(out, vec->plain, vec->len))
+		fail |= HXT_FAIL_D;
+
+	return fail;
+}
+
+static void hxt_sum_add(struct hxt_sum *sum, int fail, uint64_t ns,
+			uint64_t bytes)
+{
+	if (fail)
+		++sum->fail;
+	else
+		++sum->pass;
+
+	sum->ns += ns;
+	sum->bytes += bytes;
+}
+
+static double hxt_ns_per_byte(uint64_t ns, uint64_t bytes)
+{
+	return bytes ? (double)ns / bytes : 0;
+}
+
+static int hxt_dir_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+int main(int argc, char **argv)
+{
+	struct hxt_sum sum_e[HXT_VARIANTS] = {};
+	struct hxt_sum sum_d[HXT_VARIANTS] = {};
+	struct hxt_vec vec;
+	struct hx_state *hx = NULL;
+	uint8_t *out = NULL;
+	struct dirent *de;
+	DIR *d;
+	char **dirs = NULL;
+	size_t dir_i, dir_count = 0;
+	char *path;
+	unsigned i, repeat = 100;
+	unsigned vec_count = 0;
+	size_t v;
+
+	int rc, errflg = 0;
+	size_t fail = 0;
+
+	char *arg_d = "test";
+	char *arg_n = NULL;
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "d:n:v")) != -1) {
+		switch (rc) {
+		case 'd': /* test directory: string */
+			arg_d = optarg;
+			break;
+
+		case 'n': /* repeat count: numeric */
+			arg_n = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s [-d <dir>] [-n <repeat>] [-v]\n"
+			"\n"
+			"  Options:\n"
+			"    -d <dir>\n"
+			"      Directory of j*-k* test vectors (default: test)\n"
+			"    -n <repeat>\n"
+			"      Times to run each vector, for timing (default: 100)\n"
+			"\n"
+			"  -v\n"
+			"      Print each vector (may be repeated for debug)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	if (arg_n) {
+		unsigned long val;
+
+		errno = 0;
+		val = strtoul(arg_n, NULL, 0);
+		if (errno || !val || val > UINT32_MAX) {
+			fprintf(stderr, "invalid -n '%s'\n", arg_n);
+			exit(1);
+		}
+
+		repeat = (unsigned)val;
+	}
+
+	d = opendir(arg_d);
+	if (!d) {
+		fprintf(stderr, "invalid -d '%s'\n", arg_d);
+		exit(1);
+	}
+
+	while ((de = readdir(d))) {
+		unsigned j, k;
+
+		if (sscanf(de->d_name, "j%u-k%u", &j, &k) != 2)
+			continue;
+
+		dirs = realloc(dirs, sizeof(*dirs) * (dir_count + 1));
+		dirs[dir_count++] = strdup(de->d_name);
+	}
+
+	closedir(d);
+
+	qsort(dirs, dir_count, sizeof(*dirs), hxt_dir_cmp);
+
+	for (dir_i = 0; dir_i < dir_count; ++dir_i) {
+		if (asprintf(&path, "%s/%s", arg_d, dirs[dir_i]) < 0)
+			exit(1);
+
+		for (i = 0; (rc = hxt_vec_read(&vec, path, i)) != 1; ++i) {
+			if (rc) {
+				printf("%s/%u invalid vector\n", dirs[dir_i], i);
+				++fail;
+				continue;
+			}
+
+			hx = realloc(hx, sizeof(*hx) + vec.key_len);
+			out = realloc(out, vec.len + 1);
+
+			for (v = 0; v < HXT_VARIANTS; ++v) {
+				uint64_t ns_e, ns_d;
+				uint64_t bytes = (uint64_t)vec.len * repeat;
+				int fail_e, fail_d;
+
+				rc = hxt_vec_run(&vec, &hxt_variants[v], hx,
+						 out, repeat, &ns_e, &ns_d);
+				fail_e = !!(rc & HXT_FAIL_E);
+				fail_d = !!(rc & HXT_FAIL_D);
+
+				hxt_sum_add(&sum_e[v], fail_e, ns_e, bytes);
+				hxt_sum_add(&sum_d[v], fail_d, ns_d, bytes);
+				fail += fail_e + fail_d;
+
+				if (hohha_dbg_level || fail_e || fail_d)
+					printf("%s/%u %-5s "
+					       "encr %s %6.2f ns/B "
+					       "decr %s %6.2f ns/B\n",
+					       dirs[dir_i], i,
+					       hxt_variants[v].name,
+					       fail_e ? "FAIL" : "pass",
+					       hxt_ns_per_byte(ns_e, bytes),
+					       fail_d ? "FAIL" : "pass",
+					       hxt_ns_per_byte(ns_d, bytes));
+			}
+
+			++vec_count;
+			hxt_vec_free(&vec);
+		}
+
+		free(dirs[dir_i]);
+		free(path);
+	}
+
+	for (v = 0; v < HXT_VARIANTS; ++v)
+		printf("%-5s encr pass %zu fail %zu %6.2f ns/B "
+		       "decr pass %zu fail %zu %6.2f ns/B\n",
+		       hxt_variants[v].name,
+		       sum_e[v].pass, sum_e[v].fail,
+		       hxt_ns_per_byte(sum_e[v].ns, sum_e[v].bytes),
+		       sum_d[v].pass, sum_d[v].fail,
+		       hxt_ns_per_byte(sum_d[v].ns, sum_d[v].bytes));
+
+	printf("vectors: %u fail count: %zu\n", vec_count, fail);
+
+	free(dirs);
+	free(hx);
+	free(out);
+
+	if (!vec_count)
+		return 1;
+
+	return fail ? 1 : 0;
+}
@@ -6,6 +6,8 @@
 #include <syscall.h>
 #include <unistd.h>
 
+#include "hohha.h"
+
 extern unsigned hohha_dbg_level;
 
 #define pr(args...) fprintf(stderr, ##args)
@@ -17,26 +19,19 @@ extern unsigned hohha_dbg_level;
 #define getrandom(args...) syscall(__NR_getrandom, ##args)
 #endif
 
-uint32_t crc32_byte(uint32_t crc, uint8_t word);
-uint32_t crc32_data(uint8_t *data, uint32_t len);
-
-int b64_encode(const uint8_t* data_buf, size_t data_len,
-	       char* out_buf, size_t out_len);
-int b64_decode(const char *in_buf, size_t in_len,
-	       uint8_t *out_buf, size_t *out_len);
-
 void merge_sort(size_t *idx, size_t *val, size_t *tmp, size_t sa, size_t sz);
 
 size_t max_idx(size_t *val, size_t sz);
 
+/* Note: shift is modulo 32, and zero is well defined */
 static inline uint32_t rol32(uint32_t word, unsigned shift)
 {
-	return (word << shift) | (word >> (32 - shift));
+	return (word << (shift & 31)) | (word >> (-shift & 31));
 }
 
 static inline uint32_t ror32(uint32_t word, unsigned shift)
 {
-	return (word >> shift) | (word << (32 - shift));
+	return (word >> (shift & 31)) | (word << (-shift & 31));
 }
 
 static inline uint32_t shl32(uint32_t word, unsigned shift)
@@ -66,6 +61,17 @@ static inline uint32_t incr32_mask(uint32_t word, uint32_t mask)
 	return ~0;
 }
 
+/* splitmix64: a fast, seedable generator for reproducible test data */
+static inline uint64_t splitmix64(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+	return z ^ (z >> 31);
+}
+
 static inline int is_pow2(uintmax_t word)
 {
 	return !(word & (word - 1));
@@ -86,4 +92,26 @@ static inline uint32_t leu32(uint8_t *bytes)
 	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
 }
 
+/* Seed of the index'th splitmix64 stream, independent of threads. */
+static inline uint64_t splitmix64_stream(uint64_t seed, uint64_t index)
+{
+	uint64_t state = index;
+
+	return seed ^ splitmix64(&state);
+}
+
+/* Fill a buffer with bytes of the splitmix64 stream. */
+static inline void splitmix64_fill(uint64_t *state, uint8_t *buf, size_t len)
+{
+	uint64_t word = 0;
+	size_t i;
+
+	for (i = 0; i < len; ++i) {
+		if (!(i & 7))
+			word = splitmix64(state);
+		buf[i] = u8(word);
+		word >>= 8;
+	}
+}
+
 #endif
@@ -0,0 +1,577 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hohha_xor.h"
+#include "hohha_util.h"
+#include "hohha_kpa.h"
+
+/*
+ * Verify candidate keys against a known plaintext corpus.
+ *
+ * Each candidate is a key body and v, maybe partial, with a mask of the
+ * known key bytes and v bits, as printed by hohha_brut.  A pair is checked
+ * until its first mismatching byte, or for a partial key, until a step
+ * needs an unknown key byte or bit of v.  The pairs of each candidate are
+ * divided among threads, which stop at the first failing pair.
+ */
+
+/* pairs checked by each thread at a time */
+#define HXV_CHUNK 64
+
+struct hxv_cand {
+	struct hx_state *hx;		/* candidate key and v */
+	uint8_t *mask;			/* known key bytes, or NULL for all */
+	uint32_t v_mask;		/* known bits of v */
+};
+
+struct hxv_ctx {
+	struct hxk_kpa kpa;		/* known plaintext corpus */
+	size_t sz_hx;			/* size of state */
+	struct hxv_cand *cand;		/* candidate being verified */
+
+	pthread_mutex_t lock;		/* protects the first failure */
+	size_t next;			/* next chunk of pairs */
+	size_t fail_pair;		/* first failing pair, or count */
+	size_t fail_byte;		/* first failing byte of that pair */
+
+	size_t pairs_full;		/* pairs checked to the end */
+	size_t pairs_part;		/* pairs checked partly */
+	uint64_t bytes;			/* bytes checked */
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* Check one pair: zero if it passed, one if partly, negative if failed. */
+static int hxv_pair_check(struct hxv_cand *cand, struct hx_state *hx,
+			  struct hxk_pair *pair, size_t *idx)
+{
+	uint32_t need_v, j;
+	size_t i;
+
+	hx_init_salt(hx, hxk_pair_s1(pair), hxk_pair_s2(pair));
+
+	for (i = 0; i < pair->len; ++i) {
+		if (!cand->mask) {
+			hx->jump_fn(hx);
+		} else {
+			/* v rotates left each step, see hohha_brut */
+			need_v = ror32(hx->key_mask | 0xff, i & 31);
+			if (need_v & ~cand->v_mask)
+				goto part;
+
+			for (j = 0; j < hx->key_jumps; ++j) {
+				if (!cand->mask[hx->m])
+					goto part;
+				hx_jump_n(hx, j);
+			}
+		}
+
+		if (hx_step_xor(hx) != (pair->mesg[i] ^ pair->ciph[i])) {
+			*idx = i;
+			return -1;
+		}
+
+		hx_step_crc(hx, pair->mesg[i]);
+	}
+
+	*idx = i;
+	return 0;
+
+part:
+	*idx = i;
+	return 1;
+}
+
+static void hxv_fail(struct hxv_ctx *ctx, size_t pair_i, size_t byte_i)
+{
+	pthread_mutex_lock(&ctx->lock);
+
+	if (pair_i < ctx->fail_pair) {
+		ctx->fail_pair = pair_i;
+		ctx->fail_byte = byte_i;
+	}
+
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+static void *hxv_run(void *arg)
+{
+	struct hxv_ctx *ctx = arg;
+	struct hxv_cand *cand = ctx->cand;
+	struct hx_state *hx;
+	size_t first, i, idx;
+	size_t pairs_full = 0, pairs_part = 0;
+	uint64_t bytes = 0;
+	int rc;
+
+	hx = malloc(ctx->sz_hx);
+
+	for (;;) {
+		first = __atomic_fetch_add(&ctx->next, HXV_CHUNK,
+					   __ATOMIC_RELAXED);
+
+		/* pairs after the first failure do not matter */
+		if (first >= __atomic_load_n(&ctx->fail_pair,
+					     __ATOMIC_RELAXED))
+			break;
+
+		for (i = first; i < first + HXV_CHUNK &&
+		     i < ctx->kpa.count; ++i) {
+			memcpy(hx, cand->hx, ctx->sz_hx);
+
+			rc = hxv_pair_check(cand, hx, &ctx->kpa.pair[i], &idx);
+			bytes += idx;
+
+			if (rc < 0) {
+				hxv_fail(ctx, i, idx);
+				break;
+			}
+
+			if (rc)
+				++pairs_part;
+			else
+				++pairs_full;
+		}
+	}
+
+	__atomic_fetch_add(&ctx->pairs_full, pairs_full, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&ctx->pairs_part, pairs_part, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&ctx->bytes, bytes, __ATOMIC_RELAXED);
+
+	free(hx);
+
+	return NULL;
+}
+
+/* Verify one candidate: zero if it passed, nonzero if it failed. */
+static int hxv_verify(struct hxv_ctx *ctx, struct hxv_cand *cand,
+		      uint32_t num_t, size_t cand_i)
+{
+	pthread_t *thr;
+	uint32_t t;
+
+	ctx->cand = cand;
+	ctx->next = 0;
+	ctx->fail_pair = ctx->kpa.count;
+	ctx->fail_byte = 0;
+	ctx->pairs_full = 0;
+	ctx->pairs_part = 0;
+	ctx->bytes = 0;
+
+	if (num_t == 1) {
+		hxv_run(ctx);
+	} else {
+		thr = calloc(num_t, sizeof(*thr));
+
+		for (t = 0; t < num_t; ++t)
+			pthread_create(&thr[t], NULL, hxv_run, ctx);
+		for (t = 0; t < num_t; ++t)
+			pthread_join(thr[t], NULL);
+
+		free(thr);
+	}
+
+	if (ctx->fail_pair < ctx->kpa.count) {
+		printf("cand[%zu]: FAIL pair %zu byte %zu\n",
+		       cand_i, ctx->fail_pair, ctx->fail_byte);
+		return 1;
+	}
+
+	printf("cand[%zu]: pass pairs %zu full %zu part %zu bytes %llu\n",
+	       cand_i, ctx->kpa.count, ctx->pairs_full, ctx->pairs_part,
+	       (unsigned long long)ctx->bytes);
+
+	return 0;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint8_t *hxv_b64(char *arg, size_t len)
+{
+	uint8_t *raw;
+	size_t raw_len;
+
+	if (b64_decode(arg, strlen(arg), NULL, &raw_len) || raw_len != len)
+		return NULL;
+
+	raw = malloc(raw_len);
+	b64_decode(arg, strlen(arg), raw, &raw_len);
+
+	return raw;
+}
+
+static void hxv_cand_init(struct hxv_cand *cand, size_t sz_hx,
+			  uint32_t key_len, uint32_t key_jumps,
+			  uint8_t *key, uint32_t v)
+{
+	cand->hx = malloc(sz_hx);
+	hx_init(cand->hx, key, key_len, key_jumps, 0, 0, 0);
+	cand->hx->v = v;
+}
+
+/* a candidate with every byte and bit known is checked without masks */
+static void hxv_cand_full(struct hxv_cand *cand, uint32_t key_len)
+{
+	uint32_t i;
+
+	if (!cand->mask || ~cand->v_mask)
+		return;
+
+	for (i = 0; i < key_len; ++i)
+		if (!cand->mask[i])
+			return;
+
+	free(cand->mask);
+	cand->mask = NULL;
+}
+
+/*
+ * Read candidates printed by hohha_brut, as blocks of lines:
+ *
+ *   v: <v> (<mask of v>)
+ *   k: <key body>
+ *   m: <mask of key body>
+ *
+ * If the key length is zero, it is the length of the first key body.
+ */
+static size_t hxv_cand_read(struct hxv_cand **cands, FILE *f,
+			    uint32_t *key_len, uint32_t key_jumps)
+{
+	struct hxv_cand *cand;
+	size_t count = 0;
+	char *line = NULL;
+	size_t line_len = 0;
+	char *arg_k = NULL;
+	char *arg_m = NULL;
+	uint32_t v = 0, v_mask = 0;
+	uint8_t *raw_k, *raw_m;
+
+	*cands = NULL;
+
+	while (getline(&line, &line_len, f) > 0) {
+		if (sscanf(line, "v: %x (%x)", &v, &v_mask) == 2)
+			continue;
+
+		if (!arg_k && sscanf(line, "k: %ms", &arg_k) == 1)
+			continue;
+
+		if (!arg_k || sscanf(line, "m: %ms", &arg_m) != 1)
+			continue;
+
+		if (!*key_len) {
+			size_t len;
+
+			if (!b64_decode(arg_k, strlen(arg_k), NULL, &len) &&
+			    len && len <= UINT32_MAX && is_pow2(len))
+				*key_len = (uint32_t)len;
+		}
+
+		raw_k = hxv_b64(arg_k, *key_len);
+		raw_m = hxv_b64(arg_m, *key_len);
+		free(arg_m);
+		free(arg_k);
+		arg_k = NULL;
+
+		if (!raw_k || !raw_m) {
+			pr("warning: invalid candidate %zu\n", count);
+			free(raw_k);
+			free(raw_m);
+			continue;
+		}
+
+		*cands = realloc(*cands, sizeof(**cands) * (count + 1));
+		cand = &(*cands)[count++];
+
+		hxv_cand_init(cand, hx_size(*key_len), *key_len, key_jumps,
+			      raw_k, v);
+		cand->mask = raw_m;
+		cand->v_mask = v_mask;
+		hxv_cand_full(cand, *key_len);
+
+		free(raw_k);
+	}
+
+	free(arg_k);
+	free(line);
+
+	return count;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static uint32_t hxv_arg_num(char *arg, char opt)
+{
+	unsigned long val;
+
+	errno = 0;
+	val = strtoul(arg, NULL, 0);
+	if (errno || val > UINT32_MAX) {
+		fprintf(stderr, "invalid -%c '%s'\n", opt, arg);
+		exit(1);
+	}
+
+	return (uint32_t)val;
+}
+
+int main(int argc, char **argv)
+{
+	struct hxv_ctx ctx;
+	struct hxv_cand *cands = NULL;
+	size_t cand_i, cand_count = 0;
+	size_t fail = 0;
+
+	int rc, errflg = 0;
+
+	char *arg_f = NULL;
+	char *arg_c = NULL;
+	char *arg_j = NULL;
+	char *arg_l = NULL;
+	char *arg_k = NULL;
+	char *arg_m = NULL;
+	char *arg_h = NULL;
+	char *arg_H = NULL;
+	char *arg_t = NULL;
+
+	uint32_t num_j = 0;
+	uint32_t num_l = 0;
+	uint32_t num_t = 1;
+
+	memset(&ctx, 0, sizeof(ctx));
+	pthread_mutex_init(&ctx.lock, NULL);
+
+	opterr = 1;
+	while ((rc = getopt(argc, argv, "f:c:j:l:k:m:h:H:t:v")) != -1) {
+		switch (rc) {
+		case 'f': /* corpus file name: string */
+			arg_f = optarg;
+			break;
+		case 'c': /* candidates file name: string */
+			arg_c = optarg;
+			break;
+
+		case 'j': /* key jumps: numeric */
+			arg_j = optarg;
+			break;
+		case 'l': /* key length: numeric */
+			arg_l = optarg;
+			break;
+
+		case 'k': /* candidate key body: base64 */
+			arg_k = optarg;
+			break;
+		case 'm': /* candidate key mask: base64 */
+			arg_m = optarg;
+			break;
+		case 'h': /* candidate v: numeric */
+			arg_h = optarg;
+			break;
+		case 'H': /* candidate v mask: numeric */
+			arg_H = optarg;
+			break;
+
+		case 't': /* threads: numeric */
+			arg_t = optarg;
+			break;
+
+		case 'v': /* increase verbosity */
+			++hohha_dbg_level;
+			break;
+
+		case ':':
+		case '?':
+			++errflg;
+		}
+	}
+
+	if (!arg_f) {
+		fprintf(stderr, "missing -f for the corpus\n");
+		++errflg;
+	}
+
+	if (!arg_k == !arg_c) {
+		fprintf(stderr, "specify exactly one of -k or -c\n");
+		++errflg;
+	}
+
+	if (arg_c && (arg_m || arg_h || arg_H)) {
+		fprintf(stderr, "-c is not used with -m, -h, or -H\n");
+		++errflg;
+	}
+
+	if (optind != argc) {
+		fprintf(stderr, "error: trailing arguments... %s\n", argv[optind]);
+		++errflg;
+	}
+
+	if (errflg) {
+		fprintf(stderr,
+			"usage: %s -f <file> <candidates> <options> [-v]\n"
+			"\n"
+			"  Corpus:\n"
+			"    -f <file>\n"
+			"      Read known plaintext from file (text or binary)\n"
+			"    -j <jumps>\n"
+			"      Key jumps (numeric) (default: from binary corpus)\n"
+			"    -l <length>\n"
+			"      Key length (numeric) (default: from candidate)\n"
+			"\n"
+			"  Candidates: from the following options\n"
+			"    -c <file>\n"
+			"      Read candidates printed by hohha_brut ('-' for stdin)\n"
+			"    -k <body>\n"
+			"      Candidate key body (base64)\n"
+			"    -m <mask>\n"
+			"      Known bytes of -k (base64) (default: all)\n"
+			"    -h <check>\n"
+			"      Candidate v (numeric) (default: crc of -k)\n"
+			"    -H <mask>\n"
+			"      Known bits of -h (numeric) (default: all)\n"
+			"\n"
+			"  Options:\n"
+			"    -t <threads>\n"
+			"      Number of threads (default: 1)\n"
+			"\n"
+			"  -v\n"
+			"      Increase debug verbosity (may be repeated)\n"
+			"\n",
+			argv[0]);
+		exit(2);
+	}
+
+	if (arg_t) {
+		num_t = hxv_arg_num(arg_t, 't');
+		if (!num_t) {
+			fprintf(stderr, "invalid -t '%s'\n", arg_t);
+			exit(1);
+		}
+	}
+
+	{ /* arg_f */
+		FILE *f = fopen(arg_f, "r");
+
+		if (!f) {
+			fprintf(stderr, "invalid -f '%s'\n", arg_f);
+			exit(1);
+		}
+
+		if (hxk_read(&ctx.kpa, f)) {
+			fprintf(stderr, "invalid or truncated -f '%s'\n",
+				arg_f);
+			exit(1);
+		}
+
+		fclose(f);
+	}
+
+	dbg("pairs: %zu\n", ctx.kpa.count);
+
+	num_j = ctx.kpa.key_jumps;
+	if (arg_j)
+		num_j = hxv_arg_num(arg_j, 'j');
+
+	if (!num_j) {
+		fprintf(stderr, "missing -j for key jumps\n");
+		exit(1);
+	}
+
+	num_l = ctx.kpa.key_len;
+	if (arg_l)
+		num_l = hxv_arg_num(arg_l, 'l');
+
+	if (arg_k && !num_l) {
+		size_t raw_k_len;
+
+		if (b64_decode(arg_k, strlen(arg_k), NULL, &raw_k_len) ||
+		    raw_k_len > UINT32_MAX) {
+			fprintf(stderr, "invalid -k '%s'\n", arg_k);
+			exit(1);
+		}
+
+		num_l = (uint32_t)raw_k_len;
+	}
+
+	if (arg_c) {
+		FILE *f = stdin;
+
+		if (strcmp(arg_c, "-")) {
+			f = fopen(arg_c, "r");
+			if (!f) {
+				fprintf(stderr, "invalid -c '%s'\n", arg_c);
+				exit(1);
+			}
+		}
+
+		cand_count = hxv_cand_read(&cands, f, &num_l, num_j);
+
+		if (f != stdin)
+			fclose(f);
+
+		if (!cand_count) {
+			fprintf(stderr, "no candidates in -c '%s'\n", arg_c);
+			exit(1);
+		}
+	}
+
+	if (!num_l || !is_pow2(num_l)) {
+		fprintf(stderr, "missing or invalid -l for key length\n");
+		exit(1);
+	}
+
+	ctx.sz_hx = hx_size(num_l);
+
+	if (arg_k) {
+		uint8_t *raw_k;
+
+		raw_k = hxv_b64(arg_k, num_l);
+		if (!raw_k) {
+			fprintf(stderr, "invalid length -k '%s'\n", arg_k);
+			exit(1);
+		}
+
+		cands = calloc(1, sizeof(*cands));
+		cand_count = 1;
+
+		hxv_cand_init(cands, ctx.sz_hx, num_l, num_j, raw_k,
+			      crc32_data(raw_k, num_l));
+
+		if (arg_h)
+			cands->hx->v = hxv_arg_num(arg_h, 'h');
+
+		cands->v_mask = ~0;
+		if (arg_H)
+			cands->v_mask = hxv_arg_num(arg_H, 'H');
+
+		if (arg_m) {
+			cands->mask = hxv_b64(arg_m, num_l);
+			if (!cands->mask) {
+				fprintf(stderr, "invalid -m '%s'\n", arg_m);
+				exit(1);
+			}
+		} else if (arg_H) {
+			cands->mask = malloc(num_l);
+			memset(cands->mask, ~0, num_l);
+		}
+
+		hxv_cand_full(cands, num_l);
+
+		free(raw_k);
+	}
+
+	for (cand_i = 0; cand_i < cand_count; ++cand_i) {
+		fail += hxv_verify(&ctx, &cands[cand_i], num_t, cand_i);
+
+		free(cands[cand_i].hx);
+		free(cands[cand_i].mask);
+	}
+
+	printf("candidates: %zu fail count: %zu\n", cand_count, fail);
+
+	free(cands);
+	hxk_free(&ctx.kpa);
+
+	return fail ? 1 : 0;
+}
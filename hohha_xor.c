@@ -4,6 +4,11 @@
 #include "hohha_xor.h"
 #include "hohha_util.h"
 
+uint32_t hx_version(void)
+{
+	return HOHHA_VERSION;
+}
+
 void hx_init_key(struct hx_state *hx, uint8_t *key,
 		 uint32_t key_len, uint32_t key_jumps)
 {
@@ -36,11 +41,6 @@ void hx_init_salt(struct hx_state *hx,
 	     hx->s1, hx->s2, hx->m);
 }
 
-void hx_init_opt(struct hx_state *hx, uint32_t opt)
-{
-	hx->opt = opt;
-}
-
 void hx_init(struct hx_state *hx, uint8_t *key,
 	     uint32_t key_len, uint32_t key_jumps,
 	     uint32_t s1, uint32_t s2,
@@ -139,6 +139,18 @@ static void hx_jump_any(struct hx_state *hx)
 	}
 }
 
+static void hx_jump_each(struct hx_state *hx)
+{
+	uint32_t j, jumps = hx->key_jumps;
+
+	/* Note: same as the general case, but each jump by number */
+
+	hx_vdbg(hx, "start");
+
+	for (j = 0; j < jumps; ++j)
+		hx_jump_n(hx, j);
+}
+
 static void hx_jump_opt2(struct hx_state *hx)
 {
 	hx_vdbg(hx, "start");
@@ -223,6 +235,104 @@ void (*hx_jump_fn(int key_jumps))(struct hx_state *hx)
 	return hx_jump_any;
 }
 
+void hx_init_opt(struct hx_state *hx, uint32_t opt)
+{
+	hx->opt = opt;
+
+	if (opt & HX_OPT_JUMP_N)
+		hx->jump_fn = hx_jump_each;
+	else if (opt & HX_OPT_JUMP_ANY)
+		hx->jump_fn = hx_jump_any;
+	else
+		hx->jump_fn = hx_jump_fn(hx->key_jumps);
+}
+
+size_t hx_size(uint32_t key_len)
+{
+	return sizeof(struct hx_state) + key_len;
+}
+
+void hx_copy(struct hx_state *dst, struct hx_state *src)
+{
+	memcpy(dst, src, hx_size(src->key_mask + 1));
+}
+
+#define HX_SNAP_MAGIC 0x504e5348 /* "HSNP" */
+
+static void hx_put_le32(uint8_t *buf, uint32_t word)
+{
+	buf[0] = u8(word);
+	buf[1] = u8(word >> 8);
+	buf[2] = u8(word >> 16);
+	buf[3] = u8(word >> 24);
+}
+
+size_t hx_snap_len(struct hx_state *hx)
+{
+	return HX_SNAP_HEAD + hx->key_mask + 1;
+}
+
+size_t hx_snap_save(struct hx_state *hx, uint8_t *buf)
+{
+	uint32_t key_len = hx->key_mask + 1;
+
+	hx_put_le32(buf + 0, HX_SNAP_MAGIC);
+	hx_put_le32(buf + 4, key_len);
+	hx_put_le32(buf + 8, hx->key_jumps);
+	hx_put_le32(buf + 12, hx->s1);
+	hx_put_le32(buf + 16, hx->s2);
+	hx_put_le32(buf + 20, hx->m);
+	hx_put_le32(buf + 24, hx->v);
+	hx_put_le32(buf + 28, hx->cs);
+	hx_put_le32(buf + 32, hx->opt);
+	memcpy(buf + HX_SNAP_HEAD, hx->key, key_len);
+
+	return HX_SNAP_HEAD + key_len;
+}
+
+uint32_t hx_snap_key_len(uint8_t *buf, size_t len)
+{
+	uint32_t key_len;
+
+	if (len < HX_SNAP_HEAD || leu32(buf) != HX_SNAP_MAGIC)
+		return 0;
+
+	key_len = leu32(buf + 4);
+
+	if (!key_len || !is_pow2(key_len) || len - HX_SNAP_HEAD != key_len)
+		return 0;
+
+	if (leu32(buf + 20) >= key_len)
+		return 0;
+
+	/* the jump loop always jumps at least twice */
+	if (leu32(buf + 8) < 2)
+		return 0;
+
+	return key_len;
+}
+
+int hx_snap_load(struct hx_state *hx, uint8_t *buf, size_t len)
+{
+	uint32_t key_len = hx_snap_key_len(buf, len);
+
+	if (!key_len)
+		return -1;
+
+	hx->key_mask = key_len - 1;
+	hx->key_jumps = leu32(buf + 8);
+	hx->s1 = leu32(buf + 12);
+	hx->s2 = leu32(buf + 16);
+	hx->m = leu32(buf + 20);
+	hx->v = leu32(buf + 24);
+	hx->cs = leu32(buf + 28);
+	memcpy(hx->key, buf + HX_SNAP_HEAD, key_len);
+
+	hx_init_opt(hx, leu32(buf + 32));
+
+	return 0;
+}
+
 void hx_jump(struct hx_state *hx)
 {
 	hx->jump_fn(hx);
@@ -303,3 +413,141 @@ void hx_decrypt(struct hx_state *hx,
 		hx_step_crc(hx, out_buf[i]);
 	}
 }
+
+void hx_transcrypt(struct hx_state *dec,
+		   struct hx_state *enc,
+		   uint8_t *in_buf,
+		   uint8_t *out_buf,
+		   uint32_t len)
+{
+	int i;
+	uint8_t x, y, word;
+
+	vvdbg("len %u\n", len);
+
+	for (i = 0; i < len; ++i) {
+		hx_jump(dec);
+		hx_jump(enc);
+
+		x = hx_step_xor(dec);
+		y = hx_step_xor(enc);
+
+		/* plaintext is only in the middle */
+		word = hx_xor(in_buf[i], x);
+
+		hx_step_crc(dec, word);
+		hx_step_crc(enc, word);
+
+		out_buf[i] = hx_xor(word, y);
+	}
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+/* states interleaved by hx_fan_encrypt */
+#define HX_FAN_LANES 4
+
+size_t hx_fan_size(uint32_t len)
+{
+	return sizeof(struct hx_fan) + sizeof(uint32_t) * ((size_t)len + 1);
+}
+
+void hx_fan_init(struct hx_fan *fan, uint32_t cs,
+		 uint8_t *in_buf, uint32_t len)
+{
+	uint32_t i, w = 0;
+
+	fan->len = len;
+	fan->cs = cs;
+
+	/* like hx_step_crc, but without the "v" of the key */
+	for (i = 0; i < len; ++i) {
+		fan->w[i] = w;
+		cs = crc32_byte(cs, in_buf[i]);
+		w = rol32(w ^ cs, 1);
+	}
+
+	fan->w[len] = w;
+	fan->cs_end = cs;
+}
+
+/* jump of one lane, the same as hx_jump_n, on local copies of the state */
+static inline void hx_fan_jump(uint32_t jmp, uint8_t *key, uint32_t key_mask,
+			       uint32_t *s1, uint32_t *s2, uint32_t *m,
+			       uint32_t v)
+{
+	if (!(jmp & 1)) {
+		*s1 ^= key[*m];
+		key[*m] = u8(*s2);
+		*m ^= jmp ? v : *s2;
+		*m &= key_mask;
+		*s2 = rol32(*s2, 1);
+	} else {
+		*s2 ^= key[*m];
+		key[*m] = u8(*s1);
+		*m ^= jmp == 1 ? v : *s1;
+		*m &= key_mask;
+		*s1 = ror32(*s1, 1);
+	}
+}
+
+int hx_fan_encrypt(struct hx_fan *fan,
+		   struct hx_state **hx, uint32_t count,
+		   uint8_t *in_buf, uint8_t **out_buf)
+{
+	uint32_t s1[HX_FAN_LANES], s2[HX_FAN_LANES];
+	uint32_t m[HX_FAN_LANES], v[HX_FAN_LANES];
+	uint32_t i, j, k, l, lanes, jumps;
+	struct hx_state *lane;
+
+	for (k = 0; k < count; ++k)
+		if (hx[k]->cs != fan->cs)
+			return -1;
+
+	for (k = 0; k < count; k += lanes) {
+		/* lanes of the same number of jumps */
+		jumps = hx[k]->key_jumps;
+		for (lanes = 1; lanes < HX_FAN_LANES &&
+		     k + lanes < count; ++lanes)
+			if (hx[k + lanes]->key_jumps != jumps)
+				break;
+
+		for (l = 0; l < lanes; ++l) {
+			lane = hx[k + l];
+			s1[l] = lane->s1;
+			s2[l] = lane->s2;
+			m[l] = lane->m;
+			v[l] = lane->v;
+		}
+
+		/* the jump chains of each lane are independent */
+		for (i = 0; i < fan->len; ++i) {
+			for (j = 0; j < jumps; ++j) {
+				for (l = 0; l < lanes; ++l) {
+					lane = hx[k + l];
+					hx_fan_jump(j, lane->key,
+						    lane->key_mask,
+						    &s1[l], &s2[l], &m[l],
+						    v[l] ^ fan->w[i]);
+				}
+			}
+
+			for (l = 0; l < lanes; ++l) {
+				out_buf[k + l][i] = in_buf[i] ^
+					u8(v[l] ^ fan->w[i] ^ s1[l] ^ s2[l]);
+				v[l] = rol32(v[l], 1);
+			}
+		}
+
+		for (l = 0; l < lanes; ++l) {
+			lane = hx[k + l];
+			lane->s1 = s1[l];
+			lane->s2 = s2[l];
+			lane->m = m[l];
+			lane->v = v[l] ^ fan->w[fan->len];
+			lane->cs = fan->cs_end;
+		}
+	}
+
+	return 0;
+}
@@ -1,8 +1,13 @@
 #ifndef HOHHA_XOR_H
 #define HOHHA_XOR_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#ifndef HX_API
+#define HX_API __attribute__((visibility("default")))
+#endif
+
 struct hx_state {
 	/* maybe a loop unrolled jump function */
 	void (*jump_fn)(struct hx_state *hx);
@@ -26,8 +31,8 @@ struct hx_state {
  * @key_len - length of the key data
  * @key_jumps - number of hohha xor jumps
  */
-void hx_init_key(struct hx_state *hx, uint8_t *key,
-		uint32_t key_len, uint32_t key_jumps);
+HX_API void hx_init_key(struct hx_state *hx, uint8_t *key,
+			uint32_t key_len, uint32_t key_jumps);
 
 /**
  * Initialize the salt and moving pointer of the state.
@@ -38,16 +43,26 @@ void hx_init_key(struct hx_state *hx, uint8_t *key,
  * @s1 - first salt
  * @s2 - second salt
  */
-void hx_init_salt(struct hx_state *hx,
-		 uint32_t s1, uint32_t s2);
+HX_API void hx_init_salt(struct hx_state *hx,
+			 uint32_t s1, uint32_t s2);
+
+enum hx_opts {
+	HX_OPT_JUMP_ANY = 1 << 0,	/* general case jump loop */
+	HX_OPT_JUMP_N = 1 << 1,		/* each jump by hx_jump_n */
+};
 
 /**
  * Set options to affect running the algorithm.
  *
+ * The jump function is chosen by the options, so the key jumps must
+ * already be initialized.  The options select alternative, equivalent,
+ * implementations of the algorithm.  The default is the loop unrolled
+ * jump function, if there is one for the number of jumps.
+ *
  * @hx - hohha xor state
  * @opt - zero for defaults, otherwise see enum hx_opts.
  */
-void hx_init_opt(struct hx_state *hx, uint32_t opt);
+HX_API void hx_init_opt(struct hx_state *hx, uint32_t opt);
 
 /**
  * Completely initialize the state from scratch.
@@ -59,60 +74,122 @@ void hx_init_opt(struct hx_state *hx, uint32_t opt);
  * @s1 - first salt
  * @s2 - second salt
  */
-void hx_init(struct hx_state *hx, uint8_t *key,
-	     uint32_t key_len, uint32_t key_jumps,
-	     uint32_t s1, uint32_t s2,
-	     uint32_t opt);
+HX_API void hx_init(struct hx_state *hx, uint8_t *key,
+		    uint32_t key_len, uint32_t key_jumps,
+		    uint32_t s1, uint32_t s2,
+		    uint32_t opt);
+
+/**
+ * Size of a state in memory, including the key body.
+ *
+ * @key_len - length of the key data
+ */
+HX_API size_t hx_size(uint32_t key_len);
+
+/**
+ * Copy a state, to resume from the same point more than once.
+ *
+ * The copy is only valid in the same process.  See hx_snap_save() to
+ * keep the state outside of the process.
+ *
+ * @dst - state of at least hx_size() bytes
+ * @src - state to copy
+ */
+HX_API void hx_copy(struct hx_state *dst, struct hx_state *src);
+
+/* length of the snapshot header, followed by the key body */
+#define HX_SNAP_HEAD 36
+
+/**
+ * Length of a snapshot of the state.
+ *
+ * @hx - hohha xor state
+ */
+HX_API size_t hx_snap_len(struct hx_state *hx);
+
+/**
+ * Save a portable snapshot of the state.
+ *
+ * The snapshot is all of the state, except the jump function, in little
+ * endian.  Resuming from the snapshot continues the same stream of text,
+ * as if it had never been interrupted.  Returns the length of the snapshot.
+ *
+ * @hx - hohha xor state
+ * @buf - destination of at least hx_snap_len() bytes
+ */
+HX_API size_t hx_snap_save(struct hx_state *hx, uint8_t *buf);
+
+/**
+ * Length of the key body of a snapshot, to allocate a state.
+ *
+ * Returns the key length, or zero if the snapshot is invalid.
+ *
+ * @buf - snapshot
+ * @len - length of the snapshot
+ */
+HX_API uint32_t hx_snap_key_len(uint8_t *buf, size_t len);
+
+/**
+ * Resume the state from a snapshot.
+ *
+ * The jump function is chosen again from the key jumps and options.
+ * Returns zero, or nonzero if the snapshot is invalid.
+ *
+ * @hx - state of at least hx_size(hx_snap_key_len()) bytes
+ * @buf - snapshot
+ * @len - length of the snapshot
+ */
+HX_API int hx_snap_load(struct hx_state *hx, uint8_t *buf, size_t len);
 
 /**
  * Perform the first even jump.
  */
-void hx_jump0(struct hx_state *hx);
+HX_API void hx_jump0(struct hx_state *hx);
 
 /**
  * Perform the first odd jump.
  */
-void hx_jump1(struct hx_state *hx);
+HX_API void hx_jump1(struct hx_state *hx);
 
 /**
  * Perform the next even jump.
  */
-void hx_jump2(struct hx_state *hx);
+HX_API void hx_jump2(struct hx_state *hx);
 
 /**
  * Perform the next odd jump.
  */
-void hx_jump3(struct hx_state *hx);
+HX_API void hx_jump3(struct hx_state *hx);
 
 /**
  * Perform the Nth jump.
  */
-void hx_jump_n(struct hx_state *hx, uint32_t jmp);
+HX_API void hx_jump_n(struct hx_state *hx, uint32_t jmp);
 
 /**
  * Get the most optimal jump function.
  */
-void (*hx_jump_fn(int key_jumps))(struct hx_state *hx);
+HX_API void (*hx_jump_fn(int key_jumps))(struct hx_state *hx);
 
 /**
  * Perform the sequence of jumps, general case.
  */
-void hx_jump(struct hx_state *hx);
+HX_API void hx_jump(struct hx_state *hx);
 
 /**
  * Get the xor of the plain and ciphertext of the current step.
  */
-uint8_t hx_step_xor(struct hx_state *hx);
+HX_API uint8_t hx_step_xor(struct hx_state *hx);
 
 /**
 * Update the "cs" and "v" using plaintext of the current step.
 */
-void hx_step_crc(struct hx_state *hx, uint8_t word);
+HX_API void hx_step_crc(struct hx_state *hx, uint8_t word);
 
 /**
 * Return the crc32 of the plaintext after encrypting or decrypting.
 */
-uint32_t hx_text_crc(struct hx_state *hx);
+HX_API uint32_t hx_text_crc(struct hx_state *hx);
 
 /**
  * Encrypt a message using hohha xor.
@@ -122,10 +199,83 @@ uint32_t hx_text_crc(struct hx_state *hx);
  * @out_buf - destination buffer for ciphertext.
  * @len - length of text to encrypt, in bytes.
  */
-void hx_encrypt(struct hx_state *hx,
-		uint8_t *in_buf,
-		uint8_t *out_buf,
-		uint32_t len);
+HX_API void hx_encrypt(struct hx_state *hx,
+		       uint8_t *in_buf,
+		       uint8_t *out_buf,
+		       uint32_t len);
+
+/**
+ * Decrypt with one state, and encrypt the plaintext with another.
+ *
+ * The result is the same as hx_decrypt() followed by hx_encrypt(), but in
+ * one pass, and the plaintext is never stored.  The input and output may be
+ * the same buffer.
+ *
+ * @dec - properly initialized state of the ciphertext.
+ * @enc - properly initialized state of the new ciphertext.
+ * @in_buf - ciphertext to transcrypt.
+ * @out_buf - destination buffer for new ciphertext.
+ * @len - length of text to transcrypt, in bytes.
+ */
+HX_API void hx_transcrypt(struct hx_state *dec,
+			  struct hx_state *enc,
+			  uint8_t *in_buf,
+			  uint8_t *out_buf,
+			  uint32_t len);
+
+/**
+ * Plain text stream shared by many keys, see hx_fan_encrypt().
+ *
+ * The checksum "cs" depends only on the plain text.  The "v" of every key
+ * is the rotated "v" of its key, xor "w", which depends only on the plain
+ * text.  Both are computed once for all the keys.
+ */
+struct hx_fan {
+	uint32_t len;		/* length of the plain text */
+	uint32_t cs;		/* initial "cs" of each state */
+	uint32_t cs_end;	/* final "cs" of each state */
+	uint32_t w[];		/* plain text part of "v", for each step */
+};
+
+/**
+ * Size of the shared stream of a message.
+ *
+ * @len - length of text to encrypt, in bytes.
+ */
+HX_API size_t hx_fan_size(uint32_t len);
+
+/**
+ * Compute the shared stream of a message, for states with the same "cs".
+ *
+ * Freshly initialized states all have the same "cs".
+ *
+ * @fan - destination of at least hx_fan_size() bytes
+ * @cs - "cs" of every state to encrypt
+ * @in_buf - plaintext to encrypt.
+ * @len - length of text to encrypt, in bytes.
+ */
+HX_API void hx_fan_init(struct hx_fan *fan, uint32_t cs,
+			uint8_t *in_buf, uint32_t len);
+
+/**
+ * Encrypt the same message with many states.
+ *
+ * Each state produces the same ciphertext, and ends in the same state, as
+ * hx_encrypt().  Only the jumps are run for each state, interleaved a few
+ * states at a time.  The stream is not modified, so disjoint sets of states
+ * may be encrypted in parallel by different threads.
+ *
+ * Returns zero, or nonzero (and does nothing) if a "cs" differs.
+ *
+ * @fan - shared stream of the message
+ * @hx - properly initialized hohha xor states
+ * @count - number of states
+ * @in_buf - plaintext to encrypt, the same as hx_fan_init().
+ * @out_buf - destination buffer for ciphertext, of each state.
+ */
+HX_API int hx_fan_encrypt(struct hx_fan *fan,
+			  struct hx_state **hx, uint32_t count,
+			  uint8_t *in_buf, uint8_t **out_buf);
 
 /**
  * Decrypt a message using hohha xor.
@@ -135,9 +285,9 @@ void hx_encrypt(struct hx_state *hx,
  * @out_buf - destination buffer for plaintext.
  * @len - length of text to decrypt, in bytes.
  */
-void hx_decrypt(struct hx_state *hx,
-		uint8_t *in_buf,
-		uint8_t *out_buf,
-		uint32_t len);
+HX_API void hx_decrypt(struct hx_state *hx,
+		       uint8_t *in_buf,
+		       uint8_t *out_buf,
+		       uint32_t len);
 
 #endif
@@ -0,0 +1,402 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+#include <pythread.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../hohha.h"
+
+/* release the gil for texts at least this long */
+#define HXPY_NOGIL_LEN 4096
+
+typedef struct {
+	PyObject_HEAD
+	PyThread_type_lock lock;	/* held while the gil is released */
+	uint32_t key_len;		/* length of the key body */
+	struct hx_state *hx;		/* running state */
+} HxpyState;
+
+static PyTypeObject HxpyState_Type;
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxpy_lock(HxpyState *self)
+{
+	if (!PyThread_acquire_lock(self->lock, 0)) {
+		Py_BEGIN_ALLOW_THREADS
+		PyThread_acquire_lock(self->lock, 1);
+		Py_END_ALLOW_THREADS
+	}
+}
+
+static void hxpy_unlock(HxpyState *self)
+{
+	PyThread_release_lock(self->lock);
+}
+
+static HxpyState *hxpy_alloc(PyTypeObject *type, uint32_t key_len)
+{
+	HxpyState *self;
+
+	self = (HxpyState *)type->tp_alloc(type, 0);
+	if (!self)
+		return NULL;
+
+	self->lock = PyThread_allocate_lock();
+	self->key_len = key_len;
+	self->hx = PyMem_Malloc(sizeof(*self->hx) + key_len);
+
+	if (!self->lock || !self->hx) {
+		Py_DECREF(self);
+		PyErr_NoMemory();
+		return NULL;
+	}
+
+	return self;
+}
+
+static void hxpy_dealloc(HxpyState *self)
+{
+	if (self->lock)
+		PyThread_free_lock(self->lock);
+	PyMem_Free(self->hx);
+	Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static PyObject *hxpy_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "key", "jumps", "s1", "s2", "opt", NULL };
+	HxpyState *self;
+	Py_buffer key;
+	unsigned int jumps, s1, s2, opt = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*III|I", kwlist,
+					 &key, &jumps, &s1, &s2, &opt))
+		return NULL;
+
+	if (!key.len || key.len > UINT32_MAX || (key.len & (key.len - 1))) {
+		PyBuffer_Release(&key);
+		PyErr_SetString(PyExc_ValueError,
+				"key length must be a power of two");
+		return NULL;
+	}
+
+	if (jumps < 2) {
+		PyBuffer_Release(&key);
+		PyErr_SetString(PyExc_ValueError,
+				"key jumps must be at least two");
+		return NULL;
+	}
+
+	self = hxpy_alloc(type, key.len);
+	if (self)
+		hx_init(self->hx, key.buf, key.len, jumps, s1, s2, opt);
+
+	PyBuffer_Release(&key);
+
+	return (PyObject *)self;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static void hxpy_run(HxpyState *self, int encrypt,
+		     uint8_t *in_buf, uint8_t *out_buf, Py_ssize_t len)
+{
+	uint32_t chunk;
+
+	while (len) {
+		chunk = len > UINT32_MAX ? UINT32_MAX : (uint32_t)len;
+
+		if (encrypt)
+			hx_encrypt(self->hx, in_buf, out_buf, chunk);
+		else
+			hx_decrypt(self->hx, in_buf, out_buf, chunk);
+
+		in_buf += chunk;
+		out_buf += chunk;
+		len -= chunk;
+	}
+}
+
+static PyObject *hxpy_crypt(HxpyState *self, PyObject *args,
+			    PyObject *kwds, int encrypt)
+{
+	static char *kwlist[] = { "data", "out", NULL };
+	PyObject *out = NULL;
+	PyObject *ret;
+	Py_buffer in_view, out_view;
+	uint8_t *out_buf;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwds, "y*|O", kwlist,
+					 &in_view, &out))
+		return NULL;
+
+	if (out && out != Py_None) {
+		if (PyObject_GetBuffer(out, &out_view, PyBUF_WRITABLE)) {
+			PyBuffer_Release(&in_view);
+			return NULL;
+		}
+		if (out_view.len < in_view.len) {
+			PyBuffer_Release(&out_view);
+			PyBuffer_Release(&in_view);
+			PyErr_SetString(PyExc_ValueError,
+					"out is shorter than data");
+			return NULL;
+		}
+		Py_INCREF(out);
+		ret = out;
+		out_buf = out_view.buf;
+	} else {
+		out_view.obj = NULL;
+		ret = PyBytes_FromStringAndSize(NULL, in_view.len);
+		if (!ret) {
+			PyBuffer_Release(&in_view);
+			return NULL;
+		}
+		out_buf = (uint8_t *)PyBytes_AS_STRING(ret);
+	}
+
+	hxpy_lock(self);
+
+	if (in_view.len >= HXPY_NOGIL_LEN) {
+		Py_BEGIN_ALLOW_THREADS
+		hxpy_run(self, encrypt, in_view.buf, out_buf, in_view.len);
+		Py_END_ALLOW_THREADS
+	} else {
+		hxpy_run(self, encrypt, in_view.buf, out_buf, in_view.len);
+	}
+
+	hxpy_unlock(self);
+
+	if (out_view.obj)
+		PyBuffer_Release(&out_view);
+	PyBuffer_Release(&in_view);
+
+	return ret;
+}
+
+static PyObject *hxpy_encrypt(HxpyState *self, PyObject *args, PyObject *kwds)
+{
+	return hxpy_crypt(self, args, kwds, 1);
+}
+
+static PyObject *hxpy_decrypt(HxpyState *self, PyObject *args, PyObject *kwds)
+{
+	return hxpy_crypt(self, args, kwds, 0);
+}
+
+static PyObject *hxpy_copy(HxpyState *self, PyObject *unused)
+{
+	HxpyState *dup;
+
+	dup = hxpy_alloc(Py_TYPE(self), self->key_len);
+	if (!dup)
+		return NULL;
+
+	hxpy_lock(self);
+	memcpy(dup->hx, self->hx, sizeof(*self->hx) + self->key_len);
+	hxpy_unlock(self);
+
+	return (PyObject *)dup;
+}
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static PyObject *hxpy_get_u32(HxpyState *self, void *closure)
+{
+	uint32_t *field = (void *)((char *)self->hx + (size_t)closure);
+	uint32_t val;
+
+	hxpy_lock(self);
+	val = *field;
+	hxpy_unlock(self);
+
+	return PyLong_FromUnsignedLong(val);
+}
+
+static int hxpy_set_u32(HxpyState *self, PyObject *value, void *closure)
+{
+	uint32_t *field = (void *)((char *)self->hx + (size_t)closure);
+	unsigned long val;
+
+	if (!value) {
+		PyErr_SetString(PyExc_AttributeError, "cannot delete field");
+		return -1;
+	}
+
+	val = PyLong_AsUnsignedLong(value);
+	if (PyErr_Occurred())
+		return -1;
+
+	if (val > UINT32_MAX) {
+		PyErr_SetString(PyExc_OverflowError, "field is 32 bits");
+		return -1;
+	}
+
+	/* the moving pointer indexes the key body */
+	if ((size_t)closure == offsetof(struct hx_state, m) &&
+	    val > self->hx->key_mask) {
+		PyErr_SetString(PyExc_ValueError,
+				"moving pointer is past the key body");
+		return -1;
+	}
+
+	hxpy_lock(self);
+	*field = (uint32_t)val;
+	hxpy_unlock(self);
+
+	return 0;
+}
+
+static PyObject *hxpy_get_key(HxpyState *self, void *closure)
+{
+	PyObject *ret;
+
+	hxpy_lock(self);
+	ret = PyBytes_FromStringAndSize((char *)self->hx->key, self->key_len);
+	hxpy_unlock(self);
+
+	return ret;
+}
+
+static PyObject *hxpy_get_text_crc(HxpyState *self, void *closure)
+{
+	uint32_t crc;
+
+	hxpy_lock(self);
+	crc = hx_text_crc(self->hx);
+	hxpy_unlock(self);
+
+	return PyLong_FromUnsignedLong(crc);
+}
+
+#define HXPY_FIELD(name, set, doc) \
+	{ #name, (getter)hxpy_get_u32, set, doc, \
+	  (void *)offsetof(struct hx_state, name) }
+
+static PyGetSetDef hxpy_getset[] = {
+	HXPY_FIELD(key_jumps, NULL, "number of jumps"),
+	HXPY_FIELD(key_mask, NULL, "key length mask"),
+	HXPY_FIELD(s1, (setter)hxpy_set_u32, "first salt"),
+	HXPY_FIELD(s2, (setter)hxpy_set_u32, "second salt"),
+	HXPY_FIELD(m, (setter)hxpy_set_u32, "moving pointer"),
+	HXPY_FIELD(v, (setter)hxpy_set_u32, "v of key and plain crc"),
+	HXPY_FIELD(cs, (setter)hxpy_set_u32, "plain crc"),
+	{ "key", (getter)hxpy_get_key, NULL, "current key body", NULL },
+	{ "text_crc", (getter)hxpy_get_text_crc, NULL,
+	  "crc32 of the plaintext so far", NULL },
+	{ NULL }
+};
+
+static PyMethodDef hxpy_methods[] = {
+	{ "encrypt", (PyCFunction)hxpy_encrypt, METH_VARARGS | METH_KEYWORDS,
+	  "encrypt(data, out=None)\n\n"
+	  "Encrypt the plaintext, continuing the stream.  The ciphertext is\n"
+	  "written to out, if given, otherwise returned as bytes." },
+	{ "decrypt", (PyCFunction)hxpy_decrypt, METH_VARARGS | METH_KEYWORDS,
+	  "decrypt(data, out=None)\n\n"
+	  "Decrypt the ciphertext, continuing the stream.  The plaintext is\n"
+	  "written to out, if given, otherwise returned as bytes." },
+	{ "copy", (PyCFunction)hxpy_copy, METH_NOARGS,
+	  "copy()\n\nReturn an independent copy of the running state." },
+	{ NULL }
+};
+
+static PyTypeObject HxpyState_Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "hohha.State",
+	.tp_doc = "State(key, jumps, s1, s2, opt=0)\n\n"
+		  "Hohha xor state, initialized by hx_init.",
+	.tp_basicsize = sizeof(HxpyState),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_new = hxpy_new,
+	.tp_dealloc = (destructor)hxpy_dealloc,
+	.tp_methods = hxpy_methods,
+	.tp_getset = hxpy_getset,
+};
+
+/* --- --- --- --- --- --- --- --- --- */
+
+static PyObject *hxpy_new_init(PyObject *module, PyObject *args,
+			       PyObject *kwds)
+{
+	return hxpy_new(&HxpyState_Type, args, kwds);
+}
+
+static PyObject *hxpy_crc32_data(PyObject *module, PyObject *args)
+{
+	Py_buffer data;
+	uint32_t crc = 0;
+	uint32_t chunk;
+	uint8_t *buf;
+	Py_ssize_t len;
+
+	if (!PyArg_ParseTuple(args, "y*", &data))
+		return NULL;
+
+	buf = data.buf;
+	len = data.len;
+
+	if (len > UINT32_MAX) {
+		PyBuffer_Release(&data);
+		PyErr_SetString(PyExc_OverflowError, "data is too long");
+		return NULL;
+	}
+
+	chunk = (uint32_t)len;
+
+	if (len >= HXPY_NOGIL_LEN) {
+		Py_BEGIN_ALLOW_THREADS
+		crc = crc32_data(buf, chunk);
+		Py_END_ALLOW_THREADS
+	} else {
+		crc = crc32_data(buf, chunk);
+	}
+
+	PyBuffer_Release(&data);
+
+	return PyLong_FromUnsignedLong(crc);
+}
+
+static PyMethodDef hxpy_module_methods[] = {
+	{ "init", (PyCFunction)hxpy_new_init, METH_VARARGS | METH_KEYWORDS,
+	  "init(key, jumps, s1, s2, opt=0)\n\nSame as State(...)." },
+	{ "crc32_data", hxpy_crc32_data, METH_VARARGS,
+	  "crc32_data(data)\n\nReturn the hohha-crc of the data." },
+	{ NULL }
+};
+
+static struct PyModuleDef hxpy_module = {
+	PyModuleDef_HEAD_INIT,
+	.m_name = "hohha",
+	.m_doc = "In process Hohha Dynamic XOR, using libhohha.",
+	.m_size = -1,
+	.m_methods = hxpy_module_methods,
+};
+
+PyMODINIT_FUNC PyInit_hohha(void)
+{
+	PyObject *m;
+
+	if (PyType_Ready(&HxpyState_Type))
+		return NULL;
+
+	m = PyModule_Create(&hxpy_module);
+	if (!m)
+		return NULL;
+
+	Py_INCREF(&HxpyState_Type);
+	if (PyModule_AddObject(m, "State", (PyObject *)&HxpyState_Type)) {
+		Py_DECREF(&HxpyState_Type);
+		Py_DECREF(m);
+		return NULL;
+	}
+
+	PyModule_AddIntConstant(m, "version", hx_version());
+
+	return m;
+}